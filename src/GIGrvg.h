@@ -24,6 +24,7 @@ double do_rgig1(double lambda, double chi, double psi);
 /*---------------------------------------------------------------------------*/
 /* Draw sample from GIG distribution                                         */
 /* without calling GetRNGstate() ... PutRNGstate()                           */
+/* (in gig.cpp, through gig_sampler with R's generator)                      */
 /*---------------------------------------------------------------------------*/
 
 SEXP dgig(SEXP sexp_x, SEXP sexp_lambda, SEXP sexp_chi, SEXP sexp_psi, SEXP sexp_logvalue);
@@ -10,6 +10,16 @@ Rcpp::Rostream<true>&  Rcpp::Rcout = Rcpp::Rcpp_cout_get();
 Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
+// set_bessel_exact
+void set_bessel_exact(bool exact);
+RcppExport SEXP _drbart_set_bessel_exact(SEXP exactSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type exact(exactSEXP);
+    set_bessel_exact(exact);
+    return R_NilValue;
+END_RCPP
+}
 // do_rgig1
 double do_rgig1(double lambda, double chi, double psi);
 RcppExport SEXP _drbart_do_rgig1(SEXP lambdaSEXP, SEXP chiSEXP, SEXP psiSEXP) {
@@ -93,13 +103,15 @@ BEGIN_RCPP
 END_RCPP
 }
 // drbart_l
-List drbart_l(NumericVector y_, NumericVector x_, List xinfo_list, int burn, int nd, int thin, int printevery, int m, double alpha, double beta, double lambda, double nu, double kfac, IntegerVector trunc_below, CharacterVector treef_name_);
-RcppExport SEXP _drbart_drbart_l(SEXP y_SEXP, SEXP x_SEXP, SEXP xinfo_listSEXP, SEXP burnSEXP, SEXP ndSEXP, SEXP thinSEXP, SEXP printeverySEXP, SEXP mSEXP, SEXP alphaSEXP, SEXP betaSEXP, SEXP lambdaSEXP, SEXP nuSEXP, SEXP kfacSEXP, SEXP trunc_belowSEXP, SEXP treef_name_SEXP) {
+List drbart_l(NumericVector y_, NumericVector u_, NumericVector x_, CharacterVector x_file_, List xinfo_list, int burn, int nd, int thin, int printevery, int m, double alpha, double beta, double lambda, double nu, double kfac, int mean_blocks, IntegerVector trunc_below, CharacterVector treef_name_, CharacterVector checkpoint_name_, int checkpoint_every, CharacterVector init_treef_name_, CharacterVector u_output_, CharacterVector u_file_, bool compact_trees, int n_threads);
+RcppExport SEXP _drbart_drbart_l(SEXP y_SEXP, SEXP u_SEXP, SEXP x_SEXP, SEXP x_file_SEXP, SEXP xinfo_listSEXP, SEXP burnSEXP, SEXP ndSEXP, SEXP thinSEXP, SEXP printeverySEXP, SEXP mSEXP, SEXP alphaSEXP, SEXP betaSEXP, SEXP lambdaSEXP, SEXP nuSEXP, SEXP kfacSEXP, SEXP mean_blocksSEXP, SEXP trunc_belowSEXP, SEXP treef_name_SEXP, SEXP checkpoint_name_SEXP, SEXP checkpoint_everySEXP, SEXP init_treef_name_SEXP, SEXP u_output_SEXP, SEXP u_file_SEXP, SEXP compact_treesSEXP, SEXP n_threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericVector >::type y_(y_SEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type u_(u_SEXP);
     Rcpp::traits::input_parameter< NumericVector >::type x_(x_SEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type x_file_(x_file_SEXP);
     Rcpp::traits::input_parameter< List >::type xinfo_list(xinfo_listSEXP);
     Rcpp::traits::input_parameter< int >::type burn(burnSEXP);
     Rcpp::traits::input_parameter< int >::type nd(ndSEXP);
@@ -111,21 +123,30 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type lambda(lambdaSEXP);
     Rcpp::traits::input_parameter< double >::type nu(nuSEXP);
     Rcpp::traits::input_parameter< double >::type kfac(kfacSEXP);
+    Rcpp::traits::input_parameter< int >::type mean_blocks(mean_blocksSEXP);
     Rcpp::traits::input_parameter< IntegerVector >::type trunc_below(trunc_belowSEXP);
     Rcpp::traits::input_parameter< CharacterVector >::type treef_name_(treef_name_SEXP);
-    rcpp_result_gen = Rcpp::wrap(drbart_l(y_, x_, xinfo_list, burn, nd, thin, printevery, m, alpha, beta, lambda, nu, kfac, trunc_below, treef_name_));
+    Rcpp::traits::input_parameter< CharacterVector >::type checkpoint_name_(checkpoint_name_SEXP);
+    Rcpp::traits::input_parameter< int >::type checkpoint_every(checkpoint_everySEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type init_treef_name_(init_treef_name_SEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type u_output_(u_output_SEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type u_file_(u_file_SEXP);
+    Rcpp::traits::input_parameter< bool >::type compact_trees(compact_treesSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(drbart_l(y_, u_, x_, x_file_, xinfo_list, burn, nd, thin, printevery, m, alpha, beta, lambda, nu, kfac, mean_blocks, trunc_below, treef_name_, checkpoint_name_, checkpoint_every, init_treef_name_, u_output_, u_file_, compact_trees, n_threads));
     return rcpp_result_gen;
 END_RCPP
 }
 // drbartRcppHeteroClean
-List drbartRcppHeteroClean(NumericVector y_, NumericVector x_, NumericVector xprec_, List xinfo_list, List xinfo_prec_list, int burn, int nd, int thin, int printevery, int m, int mprec, double alpha, double beta, double nu, double kfac, double phi0, bool scalemix, IntegerVector trunc_below, CharacterVector treef_name_, CharacterVector treef_prec_name_);
-RcppExport SEXP _drbart_drbartRcppHeteroClean(SEXP y_SEXP, SEXP x_SEXP, SEXP xprec_SEXP, SEXP xinfo_listSEXP, SEXP xinfo_prec_listSEXP, SEXP burnSEXP, SEXP ndSEXP, SEXP thinSEXP, SEXP printeverySEXP, SEXP mSEXP, SEXP mprecSEXP, SEXP alphaSEXP, SEXP betaSEXP, SEXP nuSEXP, SEXP kfacSEXP, SEXP phi0SEXP, SEXP scalemixSEXP, SEXP trunc_belowSEXP, SEXP treef_name_SEXP, SEXP treef_prec_name_SEXP) {
+List drbartRcppHeteroClean(NumericVector y_, NumericVector u_, NumericVector x_, CharacterVector x_file_, List xinfo_list, List xinfo_prec_list, int burn, int nd, int thin, int printevery, int m, int mprec, double alpha, double beta, double nu, double kfac, double phi0, bool scalemix, int mean_blocks, int prec_blocks, NumericVector temps, IntegerVector trunc_below, CharacterVector treef_name_, CharacterVector treef_prec_name_, CharacterVector checkpoint_name_, int checkpoint_every, CharacterVector init_treef_name_, CharacterVector init_treef_prec_name_, CharacterVector u_output_, CharacterVector u_file_, bool compact_trees, int n_threads);
+RcppExport SEXP _drbart_drbartRcppHeteroClean(SEXP y_SEXP, SEXP u_SEXP, SEXP x_SEXP, SEXP x_file_SEXP, SEXP xinfo_listSEXP, SEXP xinfo_prec_listSEXP, SEXP burnSEXP, SEXP ndSEXP, SEXP thinSEXP, SEXP printeverySEXP, SEXP mSEXP, SEXP mprecSEXP, SEXP alphaSEXP, SEXP betaSEXP, SEXP nuSEXP, SEXP kfacSEXP, SEXP phi0SEXP, SEXP scalemixSEXP, SEXP mean_blocksSEXP, SEXP prec_blocksSEXP, SEXP tempsSEXP, SEXP trunc_belowSEXP, SEXP treef_name_SEXP, SEXP treef_prec_name_SEXP, SEXP checkpoint_name_SEXP, SEXP checkpoint_everySEXP, SEXP init_treef_name_SEXP, SEXP init_treef_prec_name_SEXP, SEXP u_output_SEXP, SEXP u_file_SEXP, SEXP compact_treesSEXP, SEXP n_threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericVector >::type y_(y_SEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type u_(u_SEXP);
     Rcpp::traits::input_parameter< NumericVector >::type x_(x_SEXP);
-    Rcpp::traits::input_parameter< NumericVector >::type xprec_(xprec_SEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type x_file_(x_file_SEXP);
     Rcpp::traits::input_parameter< List >::type xinfo_list(xinfo_listSEXP);
     Rcpp::traits::input_parameter< List >::type xinfo_prec_list(xinfo_prec_listSEXP);
     Rcpp::traits::input_parameter< int >::type burn(burnSEXP);
@@ -140,10 +161,45 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type kfac(kfacSEXP);
     Rcpp::traits::input_parameter< double >::type phi0(phi0SEXP);
     Rcpp::traits::input_parameter< bool >::type scalemix(scalemixSEXP);
+    Rcpp::traits::input_parameter< int >::type mean_blocks(mean_blocksSEXP);
+    Rcpp::traits::input_parameter< int >::type prec_blocks(prec_blocksSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type temps(tempsSEXP);
     Rcpp::traits::input_parameter< IntegerVector >::type trunc_below(trunc_belowSEXP);
     Rcpp::traits::input_parameter< CharacterVector >::type treef_name_(treef_name_SEXP);
     Rcpp::traits::input_parameter< CharacterVector >::type treef_prec_name_(treef_prec_name_SEXP);
-    rcpp_result_gen = Rcpp::wrap(drbartRcppHeteroClean(y_, x_, xprec_, xinfo_list, xinfo_prec_list, burn, nd, thin, printevery, m, mprec, alpha, beta, nu, kfac, phi0, scalemix, trunc_below, treef_name_, treef_prec_name_));
+    Rcpp::traits::input_parameter< CharacterVector >::type checkpoint_name_(checkpoint_name_SEXP);
+    Rcpp::traits::input_parameter< int >::type checkpoint_every(checkpoint_everySEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type init_treef_name_(init_treef_name_SEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type init_treef_prec_name_(init_treef_prec_name_SEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type u_output_(u_output_SEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type u_file_(u_file_SEXP);
+    Rcpp::traits::input_parameter< bool >::type compact_trees(compact_treesSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(drbartRcppHeteroClean(y_, u_, x_, x_file_, xinfo_list, xinfo_prec_list, burn, nd, thin, printevery, m, mprec, alpha, beta, nu, kfac, phi0, scalemix, mean_blocks, prec_blocks, temps, trunc_below, treef_name_, treef_prec_name_, checkpoint_name_, checkpoint_every, init_treef_name_, init_treef_prec_name_, u_output_, u_file_, compact_trees, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// drbartRcppHeteroResume
+List drbartRcppHeteroResume(CharacterVector checkpoint_name_, int n_threads);
+RcppExport SEXP _drbart_drbartRcppHeteroResume(SEXP checkpoint_name_SEXP, SEXP n_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type checkpoint_name_(checkpoint_name_SEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(drbartRcppHeteroResume(checkpoint_name_, n_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// checkpoint_info
+List checkpoint_info(CharacterVector checkpoint_name_);
+RcppExport SEXP _drbart_checkpoint_info(SEXP checkpoint_name_SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type checkpoint_name_(checkpoint_name_SEXP);
+    rcpp_result_gen = Rcpp::wrap(checkpoint_info(checkpoint_name_));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -151,14 +207,17 @@ END_RCPP
 RcppExport SEXP _rcpp_module_boot_TreeSamples();
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_drbart_set_bessel_exact", (DL_FUNC) &_drbart_set_bessel_exact, 1},
     {"_drbart_do_rgig1", (DL_FUNC) &_drbart_do_rgig1, 3},
     {"_drbart_gig_norm", (DL_FUNC) &_drbart_gig_norm, 3},
     {"_drbart_dmixnorm0_post", (DL_FUNC) &_drbart_dmixnorm0_post, 4},
     {"_drbart_pmixnorm0_post", (DL_FUNC) &_drbart_pmixnorm0_post, 4},
     {"_drbart_dmixnorm_post", (DL_FUNC) &_drbart_dmixnorm_post, 4},
     {"_drbart_pmixnorm_post", (DL_FUNC) &_drbart_pmixnorm_post, 4},
-    {"_drbart_drbart_l", (DL_FUNC) &_drbart_drbart_l, 15},
-    {"_drbart_drbartRcppHeteroClean", (DL_FUNC) &_drbart_drbartRcppHeteroClean, 20},
+    {"_drbart_drbart_l", (DL_FUNC) &_drbart_drbart_l, 25},
+    {"_drbart_drbartRcppHeteroClean", (DL_FUNC) &_drbart_drbartRcppHeteroClean, 32},
+    {"_drbart_drbartRcppHeteroResume", (DL_FUNC) &_drbart_drbartRcppHeteroResume, 2},
+    {"_drbart_checkpoint_info", (DL_FUNC) &_drbart_checkpoint_info, 1},
     {"_rcpp_module_boot_TreeSamples", (DL_FUNC) &_rcpp_module_boot_TreeSamples, 0},
     {NULL, NULL, 0}
 };
@@ -4,146 +4,869 @@
 #include <fstream>
 #include <vector>
 #include <ctime>
+#include <algorithm>
+#include <map>
 
 #include "rng.h"
 #include "tree.h"
 #include "info.h"
 #include "funs.h"
 #include "bd.h"
+#include "TreeSamples.h"
+#include "forestfile.h"
 
 using namespace Rcpp;
 
-class TreeSamples {
-  public:
-  bool init;
-  size_t m, p, ndraws;
-	xinfo xi;
-	std::vector<std::vector<tree> > t;
-  
-  void load(CharacterVector treef_name_) {
-    Rprintf("Loading tree information...");
-    Rprintf("\r");
-    
-    std::string treef_name = as<std::string>(treef_name_); 
-    std::ifstream treef(treef_name.c_str());
-	  treef >> xi; //load the cutpoints
-	  treef >> m;  //number of trees
-	  treef >> p;  //dimension of x's
-	  treef >> ndraws; //number of draws from the posterior that were saved.
-    
-    t.resize(ndraws,std::vector<tree>(m));
+void TreeSamples::load(CharacterVector treef_name_) {
+  Rprintf("Loading tree information...");
+  Rprintf("\r");
+
+  load_file(as<std::string>(treef_name_), false);
+
+  Rcout << "Done loading.              ";
+  Rprintf("\r");
+}
+
+void TreeSamples::load_file(const std::string& treef_name, bool last_only) {
+  prefetch_drop();
+  lazy = false;
+  cache.clear();
+  lru.clear();
+  forest_reader treef;
+  if (!treef.open(treef_name)) stop("unable to open tree file " + treef_name);
+  xi = treef.xi;
+  m = treef.m;
+  p = treef.p;
+  ndraws = treef.ndraws; //number of draws from the posterior that were saved.
+
+  if (last_only) {
+    std::vector<tree> draw;
+    t.clear();
     for (size_t i = 0; i < ndraws; i++) {
-		  for (size_t j = 0; j < m; j++) {
-			  treef >> t[i][j];
-		  }
+      if (!treef.next(draw)) break;
+      t.assign(1, draw);
+    }
+    if (t.empty()) stop("no complete draw in tree file " + treef_name);
+    ndraws = 1;
+  } else {
+    t.resize(ndraws);
+    for (size_t i = 0; i < ndraws; i++) {
+      if (!treef.next(t[i])) stop("tree file " + treef_name + " is incomplete");
     }
-    Rcout << "Done loading.              ";
-    Rprintf("\r");
-    init = true;
   }
+  init = true;
+}
+
+void TreeSamples::load_lazy(CharacterVector treef_name_, double cache_mb) {
+  prefetch_drop();
+  path = as<std::string>(treef_name_);
+  if (!reader.open(path) || !prefetch_reader.open(path)) stop("unable to open tree file " + path);
+  xi = reader.xi;
+  m = reader.m;
+  p = reader.p;
+  offsets = reader.index();
+  if (offsets.size() < reader.ndraws) stop("tree file " + path + " is incomplete");
+  ndraws = offsets.size();
+  next_i = ndraws; //unknown, seek before the first read
+  prefetch_i = prefetch_at = ndraws;
+  
+  t.clear();
+  lru.clear();
+  cache.clear();
+  cached_bytes = 0;
+  cache_bytes = std::isfinite(cache_mb) ? (size_t) (cache_mb * 1024 * 1024) : SIZE_MAX;
+  lazy = true;
+  init = true;
+}
+
+//read draw i, seeking only if r isn't already there. at is where r is.
+draw_p TreeSamples::read_draw(forest_reader& r, size_t& at, size_t i) {
+  if (at != i) r.seek(offsets, i);
+  draw_p d = std::make_shared<std::vector<tree> >();
+  at = ndraws;
+  if (!r.next(*d)) throw std::runtime_error("unable to read draw from tree file " + path);
+  at = i + 1;
+  return d;
+}
+
+void TreeSamples::cache_put(size_t i, draw_p d) {
+  if (cache.count(i)) return;
+  size_t bytes = sizeof(std::vector<tree>);
+  for (size_t j = 0; j < d->size(); j++) bytes += (*d)[j].treesize() * sizeof(tree);
+  lru.push_front(i);
+  cache[i] = cache_entry{d, bytes, lru.begin()};
+  cached_bytes += bytes;
+  //always keep the draw just added. evicted draws stay alive while in use.
+  while (cached_bytes > cache_bytes && lru.size() > 1) {
+    cache_entry& e = cache[lru.back()];
+    cached_bytes -= e.bytes;
+    cache.erase(lru.back());
+    lru.pop_back();
+  }
+}
+
+draw_p TreeSamples::draw(size_t i) {
+  if (i >= ndraws) stop("draw index out of range");
+  if (!lazy) return draw_p(draw_p(), &t[i]); //not owned
   
-  NumericMatrix predict(NumericMatrix x_) {
-    size_t n = x_.ncol();
-    NumericMatrix ypred(ndraws, n);
-    if(init) {
-      std::vector<double> x;
-      for(NumericMatrix::iterator it=x_.begin(); it!=x_.end(); ++it) x.push_back(*it);
-      
-      dinfo di;
-      di.n=n; di.p=p; di.x = &x[0]; di.y=0;
+  draw_p d;
+  auto it = cache.find(i);
+  if (it != cache.end()) {
+    lru.splice(lru.begin(), lru, it->second.pos);
+    d = it->second.d;
+  } else if (pf_valid && prefetch_i == i) {
+    d = prefetch_take();
+    cache_put(i, d);
+  } else {
+    d = read_draw(reader, next_i, i);
+    cache_put(i, d);
+  }
+  
+  //read the next draw in the background, for sequential scans
+  size_t j = i + 1;
+  if (j < ndraws && !cache.count(j) && !(pf_valid && prefetch_i == j)) {
+    if (pf_valid) {
+      size_t k = prefetch_i;
+      cache_put(k, prefetch_take());
+    }
+    prefetch_start(j);
+  }
+  return d;
+}
+
+TreeSamples::~TreeSamples() {
+  if (!prefetcher.joinable()) return;
+  prefetch_drop();
+  {
+    std::lock_guard<std::mutex> lk(pf_mtx);
+    pf_stop = true;
+  }
+  pf_cv.notify_all();
+  prefetcher.join();
+}
+
+void TreeSamples::prefetch_loop() {
+  std::unique_lock<std::mutex> lk(pf_mtx);
+  for (;;) {
+    pf_cv.wait(lk, [this]() { return pf_stop || pf_busy; });
+    if (pf_stop) return;
+    size_t i = prefetch_i;
+    lk.unlock();
+    draw_p d;
+    std::exception_ptr e;
+    try {
+      d = read_draw(prefetch_reader, prefetch_at, i);
+    } catch (...) {
+      e = std::current_exception();
+    }
+    lk.lock();
+    prefetched = d;
+    pf_err = e;
+    pf_busy = false;
+    pf_cv.notify_all();
+  }
+}
+
+void TreeSamples::prefetch_start(size_t i) {
+  if (!prefetcher.joinable()) prefetcher = std::thread(&TreeSamples::prefetch_loop, this);
+  {
+    std::lock_guard<std::mutex> lk(pf_mtx);
+    prefetch_i = i;
+    pf_valid = pf_busy = true;
+  }
+  pf_cv.notify_all();
+}
+
+draw_p TreeSamples::prefetch_take() {
+  std::unique_lock<std::mutex> lk(pf_mtx);
+  pf_cv.wait(lk, [this]() { return !pf_busy; });
+  pf_valid = false;
+  draw_p d;
+  d.swap(prefetched);
+  std::exception_ptr e;
+  std::swap(e, pf_err);
+  if (e) std::rethrow_exception(e);
+  return d;
+}
+
+void TreeSamples::prefetch_drop() {
+  std::unique_lock<std::mutex> lk(pf_mtx);
+  pf_cv.wait(lk, [this]() { return !pf_busy; });
+  pf_valid = false;
+  prefetched.reset();
+  pf_err = nullptr;
+}
+
+NumericMatrix TreeSamples::predict(NumericMatrix x_) {
+  size_t n = x_.ncol();
+  NumericMatrix ypred(ndraws, n);
+  if(init) {
+    std::vector<double> x;
+    for(NumericMatrix::iterator it=x_.begin(); it!=x_.end(); ++it) x.push_back(*it);
+
+    dinfo di;
+    di.n=n; di.p=p; di.x = &x[0]; di.y=0;
 
+    //draws in the outer loop, so each is fetched once and in order
+    for(size_t i=0;i<ndraws;i++) {
+      draw_p ti = draw(i);
       for(size_t k=0; k<n; ++k) {
-        for(size_t i=0;i<ndraws;i++) {
-    		  ypred(i,k) += fit_i(k, t[i], xi, di);
-        }
+  		  ypred(i,k) += fit_i(k, *ti, xi, di);
       }
-    } else {
-      Rcout << "Uninitialized" <<'\n';
     }
-    return ypred;
+  } else {
+    Rcout << "Uninitialized" <<'\n';
   }
-  
-  //predictions for multiplicative trees (precision)
-  NumericMatrix predict_prec(NumericMatrix x_) {
-    size_t n = x_.ncol();
-    NumericMatrix ypred(ndraws, n);
-    ypred.fill(1.0);
-    if (init) {
-      std::vector<double> x;
-      for (NumericMatrix::iterator it = x_.begin(); it != x_.end(); ++it) x.push_back(*it);
-      
-      dinfo di;
-      di.n = n; di.p = p; di.x = &x[0]; di.y = 0;
+  return ypred;
+}
+
+//predictions for multiplicative trees (precision)
+NumericMatrix TreeSamples::predict_prec(NumericMatrix x_) {
+  size_t n = x_.ncol();
+  NumericMatrix ypred(ndraws, n);
+  ypred.fill(1.0);
+  if (init) {
+    std::vector<double> x;
+    for (NumericMatrix::iterator it = x_.begin(); it != x_.end(); ++it) x.push_back(*it);
+
+    dinfo di;
+    di.n = n; di.p = p; di.x = &x[0]; di.y = 0;
 
+    for (size_t i = 0; i < ndraws; i++) {
+      draw_p ti = draw(i);
       for (size_t k = 0; k < n; ++k) {
-        for (size_t i = 0; i < ndraws; i++) {
-      	  ypred(i,k) *= fit_i_mult(k, t[i], xi, di);
+    	  ypred(i,k) *= fit_i_mult(k, *ti, xi, di);
+      }
+    }
+  } else {
+    Rcout << "Uninitialized" <<'\n';
+  }
+  return ypred;
+}
+
+//predictions from the ith mcmc iterate
+NumericMatrix TreeSamples::predict_i(NumericMatrix x_, size_t i) {
+  size_t n = x_.ncol();
+  NumericMatrix ypred(1, n);
+  if (init) {
+    std::vector<double> x;
+    for (NumericMatrix::iterator it = x_.begin(); it != x_.end(); ++it) {
+      x.push_back(*it);
+    }
+
+    dinfo di;
+    di.n = n; di.p = p; di.x = &x[0]; di.y = 0;
+
+    draw_p ti = draw(i);
+    for (size_t k = 0; k < n; ++k) {
+    	  ypred(0, k) += fit_i(k, *ti, xi, di);
+    }
+  } else {
+    Rcout << "Uninitialized" <<'\n';
+  }
+  return ypred;
+}
+
+//predictions from the ith mcmc iterate
+NumericMatrix TreeSamples::predict_prec_i(NumericMatrix x_, size_t i) {
+  size_t n = x_.ncol();
+  NumericMatrix ypred(1, n); ypred.fill(1.0);
+  if(init) {
+    std::vector<double> x;
+    for(NumericMatrix::iterator it=x_.begin(); it!=x_.end(); ++it) x.push_back(*it);
+
+    dinfo di;
+    di.n=n; di.p=p; di.x = &x[0]; di.y=0;
+
+    draw_p ti = draw(i);
+    for(size_t k=0; k<n; ++k) {
+        ypred(0,k) *= fit_i_mult(k, *ti, xi, di);
+    }
+  } else {
+    Rcout << "Uninitialized" <<'\n';
+  }
+  return ypred;
+}
+
+void TreeSamples::set_ucuts(List ucuts) {
+  upart.from_list(ucuts);
+  if (init && upart.ndraws() != ndraws) stop("u partition and tree file have different numbers of draws");
+}
+
+NumericVector TreeSamples::u_widths(size_t i) {
+  NumericVector w(upart.nintervals(i));
+  upart.widths(i, xi[0], &w[0]);
+  return w;
+}
+
+NumericVector TreeSamples::u_mids(size_t i) {
+  NumericVector mid(upart.nintervals(i));
+  upart.mids(i, xi[0], &mid[0]);
+  return mid;
+}
+
+List TreeSamples::u_logprobs() {
+  List out(upart.ndraws());
+  for (size_t i = 0; i < upart.ndraws(); i++) {
+    NumericVector w = u_widths(i);
+    for (int h = 0; h < w.size(); h++) w[h] = log(w[h]);
+    out[i] = w;
+  }
+  return out;
+}
+
+//x for each interval midpoint of draw i: column h is (mid_h, x_)
+static std::vector<double> u_design(const UPartition& upart, size_t i, xinfo& xi,
+                                    size_t p, NumericVector& x_)
+{
+  if (x_.size() + 1 != (int) p) stop("x has the wrong number of covariates");
+  size_t nmid = upart.nintervals(i);
+  std::vector<double> mid(nmid), x(nmid * p);
+  upart.mids(i, xi[0], &mid[0]);
+  for (size_t h = 0; h < nmid; h++) {
+    x[h * p] = mid[h];
+    std::copy(x_.begin(), x_.end(), x.begin() + h * p + 1);
+  }
+  return x;
+}
+
+List TreeSamples::predict_u(NumericVector x_) {
+  if (!init) stop("Uninitialized");
+  List out(ndraws);
+  for (size_t i = 0; i < ndraws; i++) {
+    std::vector<double> x = u_design(upart, i, xi, p, x_);
+    dinfo di;
+    di.n = x.size() / p; di.p = p; di.x = &x[0]; di.y = 0;
+    NumericVector mu(di.n);
+    draw_p ti = draw(i);
+    for (size_t k = 0; k < di.n; k++) mu[k] = fit_i(k, *ti, xi, di);
+    out[i] = mu;
+  }
+  return out;
+}
+
+List TreeSamples::predict_sd_u(NumericVector x_, NumericVector phistar) {
+  if (!init) stop("Uninitialized");
+  List out(ndraws);
+  for (size_t i = 0; i < ndraws; i++) {
+    std::vector<double> x = u_design(upart, i, xi, p, x_);
+    dinfo di;
+    di.n = x.size() / p; di.p = p; di.x = &x[0]; di.y = 0;
+    NumericVector sd(di.n);
+    draw_p ti = draw(i);
+    for (size_t k = 0; k < di.n; k++) sd[k] = 1 / sqrt(phistar[i] * fit_i_mult(k, *ti, xi, di));
+    out[i] = sd;
+  }
+  return out;
+}
+
+void TreeSamples::load_prec(CharacterVector treef_name_, double cache_mb) {
+  prec.reset(new TreeSamples());
+  if (cache_mb < 0) {
+    prec->load_file(as<std::string>(treef_name_), false);
+  } else {
+    prec->load_lazy(treef_name_, cache_mb);
+  }
+  if (init && prec->ndraws != ndraws) stop("mean and precision tree files have different numbers of draws");
+  if (prec->p != p && prec->p + 1 != p) stop("precision trees have the wrong number of variables");
+}
+
+void TreeSamples::set_scale(NumericVector scale_) {
+  if ((size_t) scale_.size() != ndraws) stop("need one scale per draw");
+  scale.assign(scale_.begin(), scale_.end());
+}
+
+//--------------------------------------------------
+pred_rows::pred_rows(NumericMatrix& xpred, bool dedupe) : n(xpred.nrow()), nu(0), ncol(xpred.ncol()) {
+  fixed.assign(ncol, n > 0);
+  map.resize(n);
+  std::unordered_multimap<uint64_t, size_t> seen;
+  std::vector<double> r(ncol);
+  for (size_t k = 0; k < n; k++) {
+    for (size_t j = 0; j < ncol; j++) {
+      r[j] = xpred(k, j);
+      if (k && r[j] != xpred(0, j)) fixed[j] = 0;
+    }
+    //FNV-1a over the bytes of the row
+    uint64_t h = 14695981039346656037ULL;
+    const unsigned char* b = (const unsigned char*) r.data();
+    for (size_t c = 0; c < ncol * sizeof(double); c++) h = (h ^ b[c]) * 1099511628211ULL;
+    size_t u = nu;
+    if (dedupe) {
+      auto range = seen.equal_range(h);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (std::equal(r.begin(), r.end(), x.begin() + it->second * ncol)) {
+          u = it->second;
+          break;
         }
       }
-    } else {
-      Rcout << "Uninitialized" <<'\n';
     }
-    return ypred;
+    if (u == nu) {
+      x.insert(x.end(), r.begin(), r.end());
+      seen.emplace(h, nu++);
+    }
+    map[k] = u;
   }
+}
+
+std::vector<double> pred_rows::expand(const std::vector<double>& uout) const {
+  size_t nc = nu ? uout.size() / nu : 0;
+  std::vector<double> out(n * nc);
+  for (size_t c = 0; c < nc; c++)
+    for (size_t k = 0; k < n; k++) out[k + n * c] = uout[map[k] + nu * c];
+  return out;
+}
+
+void TreeSamples::specialize(std::vector<tree>& tm, std::vector<tree>* tp,
+                             const pred_rows& rows, draw_forests& f) {
+  //u, then the covariates as in row 0
+  std::vector<char> fixed(1, 0);
+  fixed.insert(fixed.end(), rows.fixed.begin(), rows.fixed.end());
+  std::vector<double> x0(p, 0.0);
+  if (rows.nu) std::copy(rows.row(0), rows.row(0) + p - 1, x0.begin() + 1);
+  f.mean.build(tm, xi, fixed, &x0[0]);
+  if (!prec) return;
+  if (prec->p == p) f.prec.build(*tp, prec->xi, fixed, &x0[0]);
+  else f.prec.build(*tp, prec->xi, rows.fixed, &x0[1]);
+}
+
+void TreeSamples::mixture(size_t i, const draw_forests& f, const double* x, normal_mixture& mix) {
+  size_t nmid = upart.nintervals(i);
+  std::vector<double> xx(p);
+  std::vector<double>& w = mix.w;
+  std::vector<double>& mu = mix.mu;
+  std::vector<double>& sd = mix.sd;
+  w.resize(nmid); mu.resize(nmid); sd.resize(nmid);
+  upart.widths(i, xi[0], &w[0]);
+  upart.mids(i, xi[0], &mu[0]);
+  std::copy(x, x + p - 1, xx.begin() + 1);
   
-  //predictions from the ith mcmc iterate
-  NumericMatrix predict_i(NumericMatrix x_, size_t i) {
-    size_t n = x_.ncol();
-    NumericMatrix ypred(1, n);
-    if (init) {
-      std::vector<double> x;
-      for (NumericMatrix::iterator it = x_.begin(); it != x_.end(); ++it) {
-        x.push_back(*it);
+  bool xonly = prec && prec->p + 1 == p;
+  for (size_t h = 0; h < nmid; h++) {
+    xx[0] = mu[h];
+    mu[h] = f.mean.fit(&xx[0]);
+    if (prec && !xonly) sd[h] = 1 / sqrt(scale[i] * f.prec.fit_mult(&xx[0]));
+  }
+  if (!prec) std::fill(sd.begin(), sd.end(), scale[i]);
+  else if (xonly) std::fill(sd.begin(), sd.end(), 1 / sqrt(scale[i] * f.prec.fit_mult(x)));
+}
+
+void TreeSamples::check_mixture(NumericMatrix& xpred) {
+  if (!init) stop("Uninitialized");
+  if ((size_t) xpred.ncol() + 1 != p) stop("xpred has the wrong number of covariates");
+  if (scale.size() != ndraws) stop("set_scale has not been called");
+  if (upart.ndraws() != ndraws) stop("set_ucuts has not been called");
+}
+
+List TreeSamples::predict_moments(NumericMatrix xpred, int n_threads) {
+  check_mixture(xpred);
+  pred_rows rows(xpred);
+  size_t nu = rows.nu;
+  std::vector<double> mean(nu * ndraws), var(nu * ndraws);
+  each_tile(n_threads, nu, false, [&](size_t i, size_t r0, size_t r1, std::vector<tree>& tm,
+                                      std::vector<tree>* tp) {
+    draw_forests f;
+    specialize(tm, tp, rows, f);
+    normal_mixture mix;
+    for (size_t r = r0; r < r1; r++) {
+      mixture(i, f, rows.row(r), mix);
+      mean[r + nu * i] = mix.mean();
+      var[r + nu * i] = mix.var();
+    }
+  });
+  NumericMatrix mean_(rows.n, ndraws), var_(rows.n, ndraws);
+  std::vector<double> m = rows.expand(mean), v = rows.expand(var);
+  std::copy(m.begin(), m.end(), mean_.begin());
+  std::copy(v.begin(), v.end(), var_.begin());
+  return List::create(_["mean"] = mean_, _["var"] = var_);
+}
+
+NumericVector TreeSamples::predict_quantiles(NumericMatrix xpred, NumericVector probs, int n_threads) {
+  check_mixture(xpred);
+  size_t nq = probs.size();
+  std::vector<double> q(probs.begin(), probs.end()), z(nq);
+  for (size_t j = 0; j < nq; j++) {
+    if (!(q[j] > 0 && q[j] < 1)) stop("probabilities must be in (0, 1)");
+    z[j] = R::qnorm(q[j], 0.0, 1.0, 1, 0);
+  }
+  //plain copies, NumericMatrix isn't safe to touch off the main thread
+  pred_rows rows(xpred);
+  size_t nu = rows.nu;
+  std::vector<double> out(nu * nq * ndraws);
+  
+  each_tile(n_threads, nu, false, [&](size_t i, size_t r0, size_t r1, std::vector<tree>& tm,
+                                      std::vector<tree>* tp) {
+    draw_forests f;
+    specialize(tm, tp, rows, f);
+    normal_mixture mix;
+    for (size_t r = r0; r < r1; r++) {
+      mixture(i, f, rows.row(r), mix);
+      for (size_t j = 0; j < nq; j++) out[r + nu * (j + nq * i)] = mix.quantile(q[j], z[j]);
+    }
+  });
+  
+  out = rows.expand(out);
+  NumericVector res(out.begin(), out.end());
+  res.attr("dim") = IntegerVector::create(rows.n, nq, ndraws);
+  return res;
+}
+
+NumericVector TreeSamples::predict_sample(NumericMatrix xpred, int n_samples, int n_threads) {
+  check_mixture(xpred);
+  if (n_samples < 1) stop("n_samples must be positive");
+  size_t n = xpred.nrow(), ns = n_samples;
+  std::vector<double> xp(xpred.begin(), xpred.end()), out(n * ns * ndraws);
+  //a stream per draw, seeded from R so set.seed() fixes the result
+  //whatever the number of threads. module methods get no RNGScope of their
+  //own, and without one .Random.seed would not move on
+  RNGScope scope;
+  std::vector<uint64_t> seeds(ndraws);
+  for (size_t i = 0; i < ndraws; i++) seeds[i] = draw_seed();
+  
+  each_draw(n_threads, [&](size_t i, std::vector<tree>& tm, std::vector<tree>* tp) {
+    RNG gen(seeds[i]);
+    //rows are (u, x), a batch of ns per row of xpred
+    std::vector<double> xx(ns * p);
+    dinfo di, dp;
+    di.n = ns; di.p = p; di.x = &xx[0]; di.y = 0;
+    bool xonly = prec && prec->p + 1 == p;
+    for (size_t k = 0; k < n; k++) {
+      for (size_t s = 0; s < ns; s++) {
+        xx[s * p] = gen.uniform();
+        for (size_t j = 0; j + 1 < p; j++) xx[s * p + j + 1] = xp[k + j * n];
+      }
+      double sdx = scale[i];
+      if (xonly) {
+        dp.n = 1; dp.p = p - 1; dp.x = &xx[1]; dp.y = 0;
+        sdx = 1 / sqrt(scale[i] * fit_i_mult(0, *tp, prec->xi, dp));
       }
-      
-      dinfo di;
-      di.n = n; di.p = p; di.x = &x[0]; di.y = 0;
+      for (size_t s = 0; s < ns; s++) {
+        double sd = sdx;
+        if (prec && !xonly) sd = 1 / sqrt(scale[i] * fit_i_mult(s, *tp, prec->xi, di));
+        out[k + n * (s + ns * i)] = fit_i(s, tm, xi, di) + sd * gen.normal();
+      }
+    }
+  });
+  
+  NumericVector res(out.begin(), out.end());
+  res.attr("dim") = IntegerVector::create(n, ns, ndraws);
+  return res;
+}
 
-      for (size_t k = 0; k < n; ++k) {
-        //for(size_t i=0;i<ndraws;i++) {
-      	  ypred(0, k) += fit_i(k, t[i], xi, di);
-        //}
+template<class G>
+void TreeSamples::reduce_draws(const pred_rows& rows, size_t ne, const std::vector<double>& pr,
+                               int n_threads, std::vector<double>& mean, std::vector<double>& q, G g) {
+  size_t nu = rows.nu, nq = pr.size();
+  mean.assign(nu * ne, 0.0);
+  std::vector<p2_quantile> sk(nu * ne * nq);
+  
+  //the sketches must see the draws in order, so a thread keeps its rows
+  each_tile(n_threads, nu, true, [&](size_t i, size_t r0, size_t r1, std::vector<tree>& tm,
+                                     std::vector<tree>* tp) {
+    draw_forests f;
+    specialize(tm, tp, rows, f);
+    normal_mixture mix;
+    std::vector<double> v(ne);
+    for (size_t r = r0; r < r1; r++) {
+      mixture(i, f, rows.row(r), mix);
+      g(mix, &v[0]);
+      for (size_t e = 0; e < ne; e++) {
+        mean[r + nu * e] += v[e];
+        for (size_t j = 0; j < nq; j++) sk[r + nu * (e + ne * j)].add(v[e], i, pr[j]);
       }
-    } else {
-      Rcout << "Uninitialized" <<'\n';
     }
-    return ypred;
-  }
+  });
   
-  //predictions from the ith mcmc iterate
-  NumericMatrix predict_prec_i(NumericMatrix x_, size_t i) {
-    size_t n = x_.ncol();
-    NumericMatrix ypred(1, n); ypred.fill(1.0);
-    if(init) {
-      std::vector<double> x;
-      for(NumericMatrix::iterator it=x_.begin(); it!=x_.end(); ++it) x.push_back(*it);
-      
-      dinfo di;
-      di.n=n; di.p=p; di.x = &x[0]; di.y=0;
+  for (size_t c = 0; c < nu * ne; c++) mean[c] /= ndraws;
+  q.resize(nu * ne * nq);
+  for (size_t c = 0; c < nu * ne * nq; c++) q[c] = sk[c].value(ndraws, pr[c / (nu * ne)]);
+  mean = rows.expand(mean);
+  q = rows.expand(q);
+}
 
-      for(size_t k=0; k<n; ++k) {
-        //for(size_t i=0;i<ndraws;i++) {
-          ypred(0,k) *= fit_i_mult(k, t[i], xi, di);
-        //}
+//columns e0, ..., e1 - 1 of a reduce_draws result, as R objects
+static List summary_list(const std::vector<double>& mean, const std::vector<double>& q,
+                         size_t n, size_t ne, size_t nq, size_t e0, size_t e1) {
+  size_t w = e1 - e0;
+  NumericMatrix mean_(n, w);
+  std::copy(mean.begin() + n * e0, mean.begin() + n * e1, mean_.begin());
+  NumericVector q_(n * w * nq);
+  for (size_t j = 0; j < nq; j++)
+    std::copy(q.begin() + n * (e0 + ne * j), q.begin() + n * (e1 + ne * j), q_.begin() + n * w * j);
+  q_.attr("dim") = IntegerVector::create(n, w, nq);
+  return List::create(_["mean"] = mean_, _["quantiles"] = q_);
+}
+
+static std::vector<double> check_probs(NumericVector probs) {
+  for (size_t j = 0; j < (size_t) probs.size(); j++)
+    if (!(probs[j] > 0 && probs[j] < 1)) stop("probabilities must be in (0, 1)");
+  return std::vector<double>(probs.begin(), probs.end());
+}
+
+List TreeSamples::predict_moments_summary(NumericMatrix xpred, NumericVector probs, int n_threads) {
+  check_mixture(xpred);
+  std::vector<double> pr = check_probs(probs), mean, q;
+  pred_rows rows(xpred);
+  reduce_draws(rows, 2, pr, n_threads, mean, q, [](normal_mixture& mix, double* v) {
+    v[0] = mix.mean();
+    v[1] = mix.var();
+  });
+  List m = summary_list(mean, q, rows.n, 2, pr.size(), 0, 1),
+       v = summary_list(mean, q, rows.n, 2, pr.size(), 1, 2);
+  return List::create(_["mean"] = m["mean"], _["quantiles"] = m["quantiles"],
+                      _["var"] = v["mean"], _["var_quantiles"] = v["quantiles"]);
+}
+
+List TreeSamples::predict_quantiles_summary(NumericMatrix xpred, NumericVector quantiles, NumericVector probs,
+                                            int n_threads) {
+  check_mixture(xpred);
+  std::vector<double> qs = check_probs(quantiles), pr = check_probs(probs), z(qs.size()), mean, q;
+  for (size_t j = 0; j < qs.size(); j++) z[j] = R::qnorm(qs[j], 0.0, 1.0, 1, 0);
+  pred_rows rows(xpred);
+  size_t ne = qs.size();
+  reduce_draws(rows, ne, pr, n_threads, mean, q, [&](normal_mixture& mix, double* v) {
+    for (size_t j = 0; j < ne; j++) v[j] = mix.quantile(qs[j], z[j]);
+  });
+  return summary_list(mean, q, rows.n, ne, pr.size(), 0, ne);
+}
+
+List TreeSamples::predict_grid_summary(NumericMatrix xpred, NumericVector ygrid, bool cdf, NumericVector probs,
+                                       int n_threads) {
+  check_mixture(xpred);
+  std::vector<double> pr = check_probs(probs), yg(ygrid.begin(), ygrid.end()), mean, q;
+  size_t ng = yg.size();
+  pred_rows rows(xpred);
+  reduce_draws(rows, ng, pr, n_threads, mean, q, [&](normal_mixture& mix, double* v) {
+    for (size_t g = 0; g < ng; g++) v[g] = cdf ? mix.cdf(yg[g]) : mix.pdf(yg[g]);
+  });
+  return summary_list(mean, q, rows.n, ng, pr.size(), 0, ng);
+}
+
+NumericVector TreeSamples::predict_grid(NumericMatrix xpred, NumericVector ygrid, bool cdf, int n_threads) {
+  check_mixture(xpred);
+  size_t ng = ygrid.size();
+  pred_rows rows(xpred);
+  size_t nu = rows.nu;
+  std::vector<double> yg(ygrid.begin(), ygrid.end()), out(nu * ng * ndraws);
+  
+  each_tile(n_threads, nu, false, [&](size_t i, size_t r0, size_t r1, std::vector<tree>& tm,
+                                      std::vector<tree>* tp) {
+    draw_forests f;
+    specialize(tm, tp, rows, f);
+    normal_mixture mix;
+    for (size_t r = r0; r < r1; r++) {
+      mixture(i, f, rows.row(r), mix);
+      for (size_t g = 0; g < ng; g++)
+        out[r + nu * (g + ng * i)] = cdf ? mix.cdf(yg[g]) : mix.pdf(yg[g]);
+    }
+  });
+  
+  out = rows.expand(out);
+  NumericVector res(out.begin(), out.end());
+  res.attr("dim") = IntegerVector::create(rows.n, ng, ndraws);
+  return res;
+}
+
+//the posterior predictive at x is the average of the draws' mixtures, F =
+//1/D sum_i F_i. with D draws,
+//   lpd  = log 1/D sum_i f_i(y), accumulated as a running log-sum-exp
+//   pit  = 1/D sum_i F_i(y)
+//   crps = int (F(z) - 1{z >= y})^2 dz
+//the crps is taken by Simpson's rule on n_grid intervals either side of y,
+//within [lo, hi], 8 sd beyond the lowest and highest component of any draw
+//(found on a first pass with lpd and pit); outside it F is 0 or 1 to double
+//precision, so the tails past y add |y - lo| or |y - hi| exactly. a second
+//pass adds each draw's cdf into F at the grid nodes, which for a component
+//costs only the nodes within 8 sd of it, so the whole is linear in the
+//number of draws. the grids of a tile of rows are held at once, at most
+//score_bytes, the draws being fetched again for each tile.
+static const double score_bytes = 256.0 * 1024 * 1024;
+
+List TreeSamples::score(NumericMatrix x, NumericVector y, int n_grid, int n_threads) {
+  check_mixture(x);
+  size_t n = x.nrow();
+  if ((size_t) y.size() != n) stop("x and y differ in length");
+  if (n_grid < 2 || n_grid % 2) stop("n_grid must be an even number, at least 2");
+  //every row is scored, its y differs even where x repeats
+  pred_rows rows(x, false);
+  std::vector<double> yv(y.begin(), y.end());
+  std::vector<double> lmax(n, -INFINITY), lsum(n, 0.0), pit(n, 0.0),
+                      lo(n, INFINITY), hi(n, -INFINITY);
+  
+  each_tile(n_threads, n, true, [&](size_t i, size_t r0, size_t r1, std::vector<tree>& tm,
+                                    std::vector<tree>* tp) {
+    draw_forests f;
+    specialize(tm, tp, rows, f);
+    normal_mixture mix;
+    for (size_t k = r0; k < r1; k++) {
+      mixture(i, f, rows.row(k), mix);
+      double l = mix.logpdf(yv[k]);
+      if (l > lmax[k]) {
+        lsum[k] = lsum[k] * exp(lmax[k] - l) + 1;
+        lmax[k] = l;
+      } else if (l > -INFINITY) {
+        lsum[k] += exp(l - lmax[k]);
+      }
+      pit[k] += mix.cdf(yv[k]);
+      for (size_t h = 0; h < mix.w.size(); h++) {
+        lo[k] = std::min(lo[k], mix.mu[h] - 8 * mix.sd[h]);
+        hi[k] = std::max(hi[k], mix.mu[h] + 8 * mix.sd[h]);
       }
-    } else {
-      Rcout << "Uninitialized" <<'\n';
     }
-    return ypred;
-  }
+  });
   
+  //row k's grid is [lo, s] and [s, hi] in n_grid intervals each, s = y
+  //clamped to [lo, hi]; node j of the lower in g[w * k + j], of the upper in
+  //g[w * k + G + 2 + j], both as differences (see normal_mixture::add_cdf)
+  size_t G = n_grid, w = 2 * (G + 2);
+  size_t tile = std::max<size_t>(1, std::min<double>(n, score_bytes / (w * sizeof(double))));
+  std::vector<double> s(n), g, crps_(n);
+  for (size_t k = 0; k < n; k++) s[k] = std::min(hi[k], std::max(lo[k], yv[k]));
+  double D = ndraws;
+  //Simpson's rule on G intervals of width dz, of e(F / D) at the nodes
+  auto simpson = [&](const double* d, double dz, double (*e)(double)) {
+    double F = 0.0, sum = 0.0;
+    for (size_t j = 0; j <= G; j++) {
+      F += d[j];
+      sum += (j == 0 || j == G ? 1 : j % 2 ? 4 : 2) * e(F / D);
+    }
+    return sum * dz / 3;
+  };
+  for (size_t k0 = 0; k0 < n; k0 += tile) {
+    size_t k1 = std::min(n, k0 + tile);
+    g.assign((k1 - k0) * w, 0.0);
+    each_tile(n_threads, k1 - k0, true, [&](size_t i, size_t r0, size_t r1, std::vector<tree>& tm,
+                                            std::vector<tree>* tp) {
+      draw_forests f;
+      specialize(tm, tp, rows, f);
+      normal_mixture mix;
+      for (size_t r = r0; r < r1; r++) {
+        size_t k = k0 + r;
+        mixture(i, f, rows.row(k), mix);
+        mix.add_cdf(lo[k], (s[k] - lo[k]) / G, G, &g[w * r]);
+        mix.add_cdf(s[k], (hi[k] - s[k]) / G, G, &g[w * r + G + 2]);
+      }
+    });
+    for (size_t k = k0; k < k1; k++) {
+      size_t r = k - k0;
+      crps_[k] = simpson(&g[w * r], (s[k] - lo[k]) / G, [](double F) { return F * F; }) +
+                 simpson(&g[w * r + G + 2], (hi[k] - s[k]) / G,
+                         [](double F) { return (1 - F) * (1 - F); }) +
+                 std::fabs(yv[k] - s[k]);
+    }
+  }
   
-  TreeSamples() {}
+  NumericVector lpd(n), crps(crps_.begin(), crps_.end()), pitv(n);
+  for (size_t k = 0; k < n; k++) {
+    lpd[k] = lmax[k] + log(lsum[k]) - log(D);
+    pitv[k] = pit[k] / D;
+  }
+  return List::create(_["lpd"] = lpd, _["crps"] = crps, _["pit"] = pitv);
+}
+
+thread_pool* TreeSamples::threads(size_t n_threads) {
+  if (!pool || pool->size() != n_threads) {
+    pool.reset();
+    pool.reset(new thread_pool(n_threads));
+  }
+  return pool.get();
+}
+
+DataFrame TreeSamples::thread_usage() {
+  if (!pool) return DataFrame();
+  return thread_stats(*pool);
+}
+
+//--------------------------------------------------
+//collapse nog nodes with a child leaf below min_leaf_obs observations of di
+//until there are none. the merged leaf gets the children's mean value,
+//weighted by their counts
+static void prune_small_leaves(tree& t, xinfo& xi, dinfo& di)
+{
+  for (;;) {
+    tree::npv bnv, nogs;
+    std::vector<int> cts = counts(t, xi, di, bnv);
+    std::map<tree::tree_cp, int> ct;
+    for (size_t k = 0; k < bnv.size(); k++) ct[bnv[k]] = cts[k];
+    t.getnogs(nogs);
+    
+    std::vector<size_t> nids;
+    std::vector<double> mus;
+    for (size_t k = 0; k < nogs.size(); k++) {
+      tree::tree_cp l = nogs[k]->getl(), r = nogs[k]->getr();
+      int nl = ct[l], nr = ct[r];
+      if (nl >= min_leaf_obs && nr >= min_leaf_obs) continue;
+      nids.push_back(nogs[k]->nid());
+      mus.push_back(nl + nr > 0 ? (nl * l->getm() + nr * r->getm()) / (nl + nr)
+                                : 0.5 * (l->getm() + r->getm()));
+    }
+    if (nids.empty()) return;
+    for (size_t k = 0; k < nids.size(); k++) t.death(nids[k], mus[k]);
+  }
+}
+
+std::vector<tree> warm_start_trees(const std::string& treef_name, xinfo& xi, size_t m,
+                                   dinfo& di)
+{
+  TreeSamples ts;
+  ts.load_file(treef_name, true);
+  if (ts.m != m) {
+    stop("warm start: " + treef_name + " has " + std::to_string(ts.m) +
+         " trees, expected " + std::to_string(m));
+  }
+  if (ts.xi.size() != xi.size()) {
+    stop("warm start: " + treef_name + " has a different number of variables");
+  }
   
-};
+  std::vector<tree>& t = ts.t[0];
+  for (size_t j = 0; j < m; j++) {
+    tree::npv nds;
+    t[j].getnodes(nds); //parents before their children
+    for (size_t k = 0; k < nds.size(); k++) {
+      if (!nds[k]->getl()) continue; //bottom node, no rule
+      size_t v = nds[k]->getv();
+      if (xi[v].empty()) stop("warm start: no cutpoints for a variable the trees split on");
+      double cut = ts.xi[v][nds[k]->getc()];
+      //nearest cutpoint in the new grid
+      size_t c = std::lower_bound(xi[v].begin(), xi[v].end(), cut) - xi[v].begin();
+      if (c == xi[v].size() || (c > 0 && cut - xi[v][c - 1] < xi[v][c] - cut)) c--;
+      //within what the (already moved) splits above allow. if they allow
+      //nothing, one side is empty and the node is pruned below
+      int L = 0, U = xi[v].size() - 1;
+      nds[k]->rg(v, &L, &U);
+      if (L <= U) c = std::min<size_t>(std::max<size_t>(c, L), U);
+      nds[k]->setc(c);
+    }
+    prune_small_leaves(t[j], xi, di);
+  }
+  return t;
+}
 
 RCPP_MODULE(TreeSamples) {
   class_<TreeSamples>( "TreeSamples" )
   .constructor()
   .method( "load", &TreeSamples::load )
+  .method( "load_lazy", &TreeSamples::load_lazy )
   .method( "predict", &TreeSamples::predict  )
   .method( "predict_prec", &TreeSamples::predict_prec  )
   .method( "predict_i", &TreeSamples::predict_i  )
   .method( "predict_prec_i", &TreeSamples::predict_prec_i  )
+  .method( "set_ucuts", &TreeSamples::set_ucuts  )
+  .method( "u_widths", &TreeSamples::u_widths  )
+  .method( "u_mids", &TreeSamples::u_mids  )
+  .method( "u_logprobs", &TreeSamples::u_logprobs  )
+  .method( "predict_u", &TreeSamples::predict_u  )
+  .method( "predict_sd_u", &TreeSamples::predict_sd_u  )
+  .method( "load_prec", &TreeSamples::load_prec  )
+  .method( "set_scale", &TreeSamples::set_scale  )
+  .method( "predict_moments", &TreeSamples::predict_moments  )
+  .method( "predict_quantiles", &TreeSamples::predict_quantiles  )
+  .method( "predict_moments_summary", &TreeSamples::predict_moments_summary  )
+  .method( "predict_quantiles_summary", &TreeSamples::predict_quantiles_summary  )
+  .method( "predict_sample", &TreeSamples::predict_sample  )
+  .method( "predict_grid_summary", &TreeSamples::predict_grid_summary  )
+  .method( "predict_grid", &TreeSamples::predict_grid  )
+  .method( "score", &TreeSamples::score  )
+  .method( "thread_usage", &TreeSamples::thread_usage  )
   ;
 }
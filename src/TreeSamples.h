@@ -0,0 +1,236 @@
+#ifndef GUARD_TreeSamples_h
+#define GUARD_TreeSamples_h
+
+#include <Rcpp.h>
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <atomic>
+
+#include "tree.h"
+#include "upartition.h"
+#include "forestfile.h"
+#include "mixture.h"
+#include "sketch.h"
+#include "flatforest.h"
+#include "threads.h"
+
+using namespace Rcpp;
+
+typedef std::shared_ptr<std::vector<tree> > draw_p;
+
+//the rows of a prediction's xpred, each distinct row once (unless dedupe is
+//false), and which covariates are the same in every row. the predictions
+//are computed for the distinct rows and copied out to the others.
+struct pred_rows {
+  size_t n, nu, ncol;        //rows, distinct rows, covariates
+  std::vector<double> x;     //the distinct rows, row major
+  std::vector<size_t> map;   //row k is distinct row map[k]
+  std::vector<char> fixed;   //fixed[j]: covariate j the same in every row
+  
+  explicit pred_rows(NumericMatrix& xpred, bool dedupe = true);
+  const double* row(size_t r) const { return &x[r * ncol]; }
+  //from blocks of nu values, one per distinct row, to blocks of n
+  std::vector<double> expand(const std::vector<double>& uout) const;
+};
+
+struct draw_forests {
+  flat_forest mean, prec;
+};
+
+//posterior draws of a forest, as written to a tree file by the samplers.
+//load() reads every draw into t. load_lazy() only indexes where each draw
+//starts in the file and reads draws as they are needed, keeping the most
+//recently used ones in a cache of bounded size; while draw i is in use,
+//draw i + 1 is read in the background.
+class TreeSamples {
+  public:
+  bool init;
+  size_t m, p, ndraws;
+	xinfo xi;
+	std::vector<std::vector<tree> > t;
+  
+  void load(CharacterVector treef_name_);
+  //read a tree file. with last_only, keep just the last complete draw
+  //(so the file of an interrupted run works too)
+  void load_file(const std::string& treef_name, bool last_only);
+  //index the file and cache at most cache_mb megabytes of draws
+  void load_lazy(CharacterVector treef_name_, double cache_mb);
+  
+  //draw i, from t or from the file
+  draw_p draw(size_t i);
+  
+  NumericMatrix predict(NumericMatrix x_);
+  NumericMatrix predict_prec(NumericMatrix x_);
+  NumericMatrix predict_i(NumericMatrix x_, size_t i);
+  NumericMatrix predict_prec_i(NumericMatrix x_, size_t i);
+  
+  //the u partition of each draw (fit$ucuts), with xi[0] the u cutpoints
+  UPartition upart;
+  void set_ucuts(List ucuts);
+  NumericVector u_widths(size_t i);
+  NumericVector u_mids(size_t i);
+  List u_logprobs();
+  //for each draw, the fit at u = each interval midpoint and the other
+  //covariates x_. predict_sd_u gives 1 / sqrt(phistar[i] * precision).
+  List predict_u(NumericVector x_);
+  List predict_sd_u(NumericVector x_, NumericVector phistar);
+  
+  //the variance side of the model. with a precision forest (variance 'ux' or
+  //'x'), the sd of draw i is 1 / sqrt(scale[i] * precision); without one
+  //(variance 'const') it is scale[i]. the precision forest depends on u if it
+  //has as many variables as this one.
+  std::unique_ptr<TreeSamples> prec;
+  std::vector<double> scale;
+  //cache_mb < 0 reads every draw up front, as load() does
+  void load_prec(CharacterVector treef_name_, double cache_mb);
+  void set_scale(NumericVector scale_);
+  //the mean and precision trees of draw i (tm and tp) specialized to the
+  //covariates fixed across rows
+  void specialize(std::vector<tree>& tm, std::vector<tree>* tp,
+                  const pred_rows& rows, draw_forests& f);
+  //the conditional density of y given covariates x (p - 1 of them, u not
+  //included) under draw i, whose trees specialized to x are f. safe off the
+  //main thread.
+  void mixture(size_t i, const draw_forests& f, const double* x, normal_mixture& mix);
+  //f(i, k0, k1, tm, tp) for every draw i and every block [k0, k1) of tile_rows
+  //of nrows rows, the (draw, block) tiles shared out among n_threads threads
+  //that all read the same trees. draws are fetched on the calling thread, a
+  //few at a time when loaded lazily. with in_order, each thread takes a
+  //block and runs it through the draws in order instead.
+  static const size_t tile_rows = 64;
+  template<class F> void each_tile(size_t n_threads, size_t nrows, bool in_order, F f);
+  //f(i, tm, tp) for every draw i on n_threads threads
+  template<class F> void each_draw(size_t n_threads, F f) {
+    each_tile(n_threads, 1, false, [&](size_t i, size_t, size_t, std::vector<tree>& tm,
+                                       std::vector<tree>* tp) { f(i, tm, tp); });
+  }
+  //conditional mean and variance of y for each row of xpred and each draw,
+  //as nrow(xpred) x ndraws matrices
+  List predict_moments(NumericMatrix xpred, int n_threads);
+  //conditional quantiles, an nrow(xpred) x length(probs) x ndraws array
+  NumericVector predict_quantiles(NumericMatrix xpred, NumericVector probs, int n_threads);
+  //predict_moments reduced while streaming over the draws, as
+  //predict_grid_summary: the posterior mean of the conditional mean (mean,
+  //nrow(xpred) x 1), P^2 estimates of its probs quantiles (quantiles,
+  //nrow(xpred) x 1 x length(probs)), and the same of the conditional
+  //variance (var, var_quantiles)
+  List predict_moments_summary(NumericMatrix xpred, NumericVector probs, int n_threads);
+  //predict_quantiles reduced the same way: mean, nrow(xpred) x
+  //length(quantiles), and quantiles, nrow(xpred) x length(quantiles) x
+  //length(probs)
+  List predict_quantiles_summary(NumericMatrix xpred, NumericVector quantiles, NumericVector probs,
+                                 int n_threads);
+  //n_samples draws of y from each draw's conditional law at each row of
+  //xpred: u ~ U(0, 1), then one pass through the forests at (u, x). an
+  //nrow(xpred) x n_samples x ndraws array.
+  NumericVector predict_sample(NumericMatrix xpred, int n_samples, int n_threads);
+  //posterior summaries of each draw's conditional pdf (or cdf) at ygrid for
+  //each row of xpred, reduced while streaming over the draws: the mean, an
+  //nrow(xpred) x length(ygrid) matrix, and P^2 estimates of the probs
+  //quantiles, an nrow(xpred) x length(ygrid) x length(probs) array
+  List predict_grid_summary(NumericMatrix xpred, NumericVector ygrid, bool cdf, NumericVector probs,
+                            int n_threads);
+  //each draw's conditional pdf (or cdf) at ygrid for each row of xpred, an
+  //nrow(xpred) x length(ygrid) x ndraws array
+  NumericVector predict_grid(NumericMatrix xpred, NumericVector ygrid, bool cdf, int n_threads);
+  //scores of the posterior predictive at held out pairs (x[k, ], y[k]):
+  //log predictive density, CRPS and PIT. the CRPS integrates the squared
+  //gap between the predictive cdf and the step at y on a grid of n_grid
+  //intervals either side of y, in time linear in the number of draws
+  List score(NumericMatrix x, NumericVector y, int n_grid, int n_threads);
+  //busy and idle time of each thread of the pool, see threads.h
+  DataFrame thread_usage();
+  
+  TreeSamples() : init(false), lazy(false) {}
+  ~TreeSamples();
+  
+  private:
+  bool lazy;
+  std::string path;
+  std::vector<int64_t> offsets;
+  forest_reader reader, prefetch_reader;
+  size_t next_i, prefetch_at;     //draw each reader is positioned at
+  //lru cache, most recent first
+  size_t cache_bytes, cached_bytes;
+  std::list<size_t> lru;
+  struct cache_entry { draw_p d; size_t bytes; std::list<size_t>::iterator pos; };
+  std::unordered_map<size_t, cache_entry> cache;
+  //one reader thread for the life of the object reads draw prefetch_i into
+  //prefetched with prefetch_reader while the caller works on the draw before
+  std::thread prefetcher;
+  std::mutex pf_mtx;
+  std::condition_variable pf_cv;
+  bool pf_valid = false;          //prefetch_i was asked for and not taken yet
+  bool pf_busy = false;           //still being read
+  bool pf_stop = false;
+  size_t prefetch_i;
+  draw_p prefetched;
+  std::exception_ptr pf_err;
+  void prefetch_loop();
+  void prefetch_start(size_t i);
+  draw_p prefetch_take();         //wait for the read and hand its draw over
+  void prefetch_drop();           //wait for the read and forget it
+  
+  //the threads for n_threads, kept from one call to the next
+  std::unique_ptr<thread_pool> pool;
+  thread_pool* threads(size_t n_threads);
+  
+  draw_p read_draw(forest_reader& r, size_t& at, size_t i);
+  void cache_put(size_t i, draw_p d);
+  void check_mixture(NumericMatrix& xpred);
+  //the posterior mean and P^2 estimates of the pr quantiles of the ne values
+  //g(mix, v) writes to v[0], ..., v[ne - 1] from each draw's mixture at each
+  //row, reduced while streaming over the draws. mean is nrow x ne and q is
+  //nrow x ne x pr.size(), both column-major over all the rows
+  template<class G> void reduce_draws(const pred_rows& rows, size_t ne, const std::vector<double>& pr,
+                                      int n_threads, std::vector<double>& mean, std::vector<double>& q,
+                                      G g);
+};
+
+template<class F>
+void TreeSamples::each_tile(size_t n_threads, size_t nrows, bool in_order, F f) {
+  size_t nt = std::max<size_t>(1, n_threads);
+  size_t nblk = (nrows + tile_rows - 1) / tile_rows;
+  bool all = !lazy && !(prec && prec->lazy);
+  size_t chunk = all ? std::max<size_t>(1, ndraws) : 4 * nt;
+  std::vector<draw_p> tm, tp;
+  pool_scope scope(threads(nt));
+  for (size_t start = 0; start < ndraws; start += chunk) {
+    size_t end = std::min(ndraws, start + chunk);
+    tm.clear(); tp.clear();
+    for (size_t i = start; i < end; i++) {
+      tm.push_back(draw(i));
+      tp.push_back(prec ? prec->draw(i) : draw_p());
+    }
+    size_t ntile = in_order ? nblk : nblk * (end - start);
+    std::atomic<size_t> next(0);
+    parallel_blocks(std::min(nt, ntile), [&](size_t) {
+      for (size_t t = next++; t < ntile; t = next++) {
+        size_t blk = t % nblk, k0 = blk * tile_rows, k1 = std::min(nrows, k0 + tile_rows);
+        size_t i0 = in_order ? start : start + t / nblk, i1 = in_order ? end : i0 + 1;
+        for (size_t i = i0; i < i1; i++) f(i, k0, k1, *tm[i - start], tp[i - start].get());
+      }
+    });
+  }
+}
+
+//--------------------------------------------------
+//the m trees of the last draw in a tree file, to start a new fit on di from.
+//cut indices are moved to the cutpoint in xi nearest the old cutpoint value,
+//since the new fit's cutpoints generally differ, kept within the range the
+//splits above allow. then splits leaving a leaf with fewer than
+//min_leaf_obs observations of di are pruned, as the u update would otherwise
+//be stuck until those leaves die.
+std::vector<tree> warm_start_trees(const std::string& treef_name, xinfo& xi, size_t m,
+                                   dinfo& di);
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef GUARD_backfit_h
+#define GUARD_backfit_h
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "tree.h"
+#include "info.h"
+#include "rng.h"
+#include "funs.h"
+#include "threads.h"
+
+/*
+Approximate block-parallel backfitting.
+
+The exact sweep updates tree j against the residual left by all other trees,
+including the ones updated just before it, so it is inherently sequential.
+Here the forest is cut into contiguous blocks that are swept concurrently,
+one thread per block. Each block starts from the residual (or, for the
+multiplicative precision forest, the fit) at the beginning of the sweep and
+only sees its own trees' changes; changes made by the other blocks during
+the sweep are invisible to it. allfit is reconciled once all blocks finish.
+
+The resulting chain does NOT target the DR-BART posterior exactly. With one
+block it reduces to the usual sweep (but we keep the sequential code path for
+that case so results under set.seed() are unchanged).
+*/
+
+//scratch and rng for one block, kept across sweeps to avoid reallocating
+struct backfit_block {
+   backfit_block(uint64_t seed) : gen(seed) {}
+   RNG gen;                   //own stream, safe to use on the worker thread
+   std::vector<double> r;     //residual seen by this block
+   std::vector<double> ftemp; //fit of current tree
+   std::vector<double> delta; //change in allfit due to this block
+   //birth/death proposals and acceptances in the last sweep
+   int birth = 0, death = 0, birth_accept = 0, death_accept = 0;
+
+   void tally(bool birth_death, bool accept_reject) {
+      if (birth_death) {
+         birth++;
+         if (accept_reject) birth_accept++;
+      } else {
+         death++;
+         if (accept_reject) death_accept++;
+      }
+   }
+};
+
+//nblocks blocks, each with its own rng seeded from R (call on the main thread)
+inline std::vector<backfit_block> make_blocks(size_t nblocks)
+{
+   std::vector<backfit_block> blocks;
+   for (size_t b = 0; b < nblocks; ++b) blocks.push_back(backfit_block(draw_seed()));
+   return blocks;
+}
+
+//--------------------------------------------------
+//sweep over an additive forest t, allfit = sum of the fits of all trees.
+//update(tree, di, block) does the birth/death and leaf draws for one tree,
+//with di.y pointing at the block's residual.
+template<class Update>
+void backfit_blocks(std::vector<tree>& t, xinfo& xi, dinfo& di, double* allfit,
+                    const double* y, std::vector<backfit_block>& blocks,
+                    Update update)
+{
+   size_t n = di.n, m = t.size();
+   size_t nb = std::min(blocks.size(), m);
+   size_t per = (m + nb - 1) / nb;
+
+   parallel_blocks(nb, [&](size_t b) {
+      backfit_block& bl = blocks[b];
+      bl.r.resize(n);
+      bl.ftemp.resize(n);
+      bl.delta.assign(n, 0.0);
+      bl.birth = bl.death = bl.birth_accept = bl.death_accept = 0;
+
+      dinfo dib = di;
+      dib.y = &bl.r[0];
+      for (size_t k = 0; k < n; k++) bl.r[k] = y[k] - allfit[k];
+
+      for (size_t j = b * per; j < std::min(m, (b + 1) * per); j++) {
+         fit(t[j], xi, dib, &bl.ftemp[0]);
+         for (size_t k = 0; k < n; k++) {
+            bl.r[k] += bl.ftemp[k];
+            bl.delta[k] -= bl.ftemp[k];
+         }
+         update(t[j], dib, bl);
+         fit(t[j], xi, dib, &bl.ftemp[0]);
+         for (size_t k = 0; k < n; k++) {
+            bl.r[k] -= bl.ftemp[k];
+            bl.delta[k] += bl.ftemp[k];
+         }
+      }
+   });
+
+   for (size_t b = 0; b < nb; b++) {
+      for (size_t k = 0; k < n; k++) allfit[k] += blocks[b].delta[k];
+   }
+}
+
+//--------------------------------------------------
+//sweep over a multiplicative precision forest t, allfitprec = product of the
+//fits of all trees. resid is y - allfit (the mean forest is held fixed).
+//update(tree, di, block) sees di.y = resid * sqrt(precision without tree).
+template<class Update>
+void backfit_prec_blocks(std::vector<tree>& t, xinfo& xi, dinfo& di,
+                         double* allfitprec, const double* resid,
+                         std::vector<backfit_block>& blocks, Update update)
+{
+   size_t n = di.n, m = t.size();
+   size_t nb = std::min(blocks.size(), m);
+   size_t per = (m + nb - 1) / nb;
+
+   parallel_blocks(nb, [&](size_t b) {
+      backfit_block& bl = blocks[b];
+      bl.r.resize(n);
+      bl.ftemp.resize(n);
+      bl.delta.assign(n, 1.0); //multiplicative change
+      bl.birth = bl.death = bl.birth_accept = bl.death_accept = 0;
+
+      dinfo dib = di;
+      dib.y = &bl.r[0];
+
+      for (size_t j = b * per; j < std::min(m, (b + 1) * per); j++) {
+         fit(t[j], xi, dib, &bl.ftemp[0]);
+         for (size_t k = 0; k < n; k++) {
+            bl.delta[k] /= bl.ftemp[k];
+            bl.r[k] = resid[k] * sqrt(allfitprec[k] * bl.delta[k]);
+         }
+         update(t[j], dib, bl);
+         fit(t[j], xi, dib, &bl.ftemp[0]);
+         for (size_t k = 0; k < n; k++) bl.delta[k] *= bl.ftemp[k];
+      }
+   });
+
+   for (size_t b = 0; b < nb; b++) {
+      for (size_t k = 0; k < n; k++) allfitprec[k] *= blocks[b].delta[k];
+   }
+}
+
+#endif
@@ -22,7 +22,7 @@ That is how the old code works.
 #ifdef MPIBART
 bool bd(tree& x, xinfo& xi, pinfo& pi, RNG& gen, size_t numslaves)
 #else
-bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
+bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen, SplitCounts* sc, size_t slot)
 #endif
 {
    tree::npv goodbots;  //nodes we could birth at (split on)
@@ -160,6 +160,8 @@ bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
 			//We also need to sync this birth to the slaves, so send this info to the slaves also.
 			//cout << "Master sending birth to slaves" << endl;
 			MPImastersendbirth(nx,v,c,mul,mur,numslaves);
+#else
+         if(sc) sc->birth(slot, v, c);
 #endif
          return true;
       } else {
@@ -262,6 +264,9 @@ bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
          //do death
 //cout << "death, mu=" << mu << endl;
          //x.deathp(nx,mu);
+#ifndef MPIBART
+         if(sc) sc->death(slot, nx->v, nx->c);
+#endif
 			x.death(nx->nid(),mu);
 #ifdef MPIBART
 			//Sync this death to the slaves
@@ -279,7 +284,7 @@ bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
    }
 }
 
-std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen)
+std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen, SplitCounts* sc, size_t slot)
 {
    tree::npv goodbots;  //nodes we could birth at (split on)
    double PBx = getpb(x,xi,pi,goodbots); //prob of a birth at x
@@ -377,6 +382,7 @@ std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo&
       //compute sufficient statistics
       sinfo sl,sr; //sl for left from nx and sr for right from nx (using rule (v,c))
       getsuffhet(x,nx,v,c,xi,di,phi,sl,sr);
+      temper(sl, pi.temper); temper(sr, pi.temper);
       
       //--------------------------------------------------
       //compute alpha
@@ -430,6 +436,7 @@ std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo&
 //cout << "birth, mul=" << mul << " mur=" << mur << endl;
          //x.birthp(nx,v,c,mul,mur);
 			x.birth(nx->nid(),v,c,mul,mur);
+         if(sc) sc->birth(slot, v, c);
          return std::make_tuple(true, true);
       } else {
          return std::make_tuple(true, false);
@@ -481,6 +488,7 @@ std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo&
 #else
       getsuffhet(x,nx->getl(),nx->getr(),xi,di,phi,sl,sr);
 #endif
+      temper(sl, pi.temper); temper(sr, pi.temper);
       //--------------------------------------------------
       //compute alpha
 
@@ -529,6 +537,7 @@ std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo&
          //do death
 //cout << "death, mu=" << mu << endl;
          //x.deathp(nx,mu);
+         if(sc) sc->death(slot, nx->v, nx->c);
 			x.death(nx->nid(),mu);
 #ifdef MPIBART
 			//Sync this death to the slaves
@@ -546,7 +555,7 @@ std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo&
    }
 }
 
-std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
+std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen, SplitCounts* sc, size_t slot)
 {
    tree::npv goodbots;  //nodes we could birth at (split on)
    double PBx = getpb(x,xi,pi,goodbots); //prob of a birth at x
@@ -635,6 +644,7 @@ std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen
       double alpha=0.0,alpha1=0.0,alpha2=0.0;
       double lill=0.0,lilr=0.0,lilt=0.0;
       if((sl.n>=5) && (sr.n>=5)) { //cludge?
+         temper(sl, pi.temper); temper(sr, pi.temper);
          lill = lilprec(sl.n,sl.sy,sl.sy2,pi.sigma,pi.tau);
          lilr = lilprec(sr.n,sr.sy,sr.sy2,pi.sigma,pi.tau);
          lilt = lilprec(sl.n+sr.n,sl.sy+sr.sy,sl.sy2+sr.sy2,pi.sigma,pi.tau);
@@ -670,6 +680,7 @@ std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen
 //cout << "birth, mul=" << mul << " mur=" << mur << endl;
          //x.birthp(nx,v,c,mul,mur);
 			x.birth(nx->nid(),v,c,mul,mur);
+         if(sc) sc->birth(slot, v, c);
 #ifdef MPIBART
 			//We also need to sync this birth to the slaves, so send this info to the slaves also.
 			//cout << "Master sending birth to slaves" << endl;
@@ -730,6 +741,7 @@ std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen
 #else
       getsuff(x,nx->getl(),nx->getr(),xi,di,sl,sr);
 #endif
+      temper(sl, pi.temper); temper(sr, pi.temper);
       //--------------------------------------------------
       //compute alpha
 
@@ -767,6 +779,7 @@ std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen
       double n;
       if(gen.uniform()<alpha) {
          mu = gen.gamma(0.5*(sr.n+sl.n) + pi.tau, 1.0)/(pi.tau + 0.5*(sr.sy2+sl.sy2));
+         if(sc) sc->death(slot, nx->v, nx->c);
 			x.death(nx->nid(),mu);
 #ifdef MPIBART
 			//Sync this death to the slaves
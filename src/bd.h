@@ -6,13 +6,15 @@
 #include "rng.h"
 #include "info.h"
 #include "tree.h"
+#include "splitcounts.h"
 
 #ifdef MPIBART
 bool bd(tree& x, xinfo& xi, pinfo& pi, RNG& gen, size_t numslaves);
 #else
-bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen);
-std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen);
-std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen);
+//an accepted birth or death is also counted in slot of sc, if there is one
+bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen, SplitCounts* sc = 0, size_t slot = 0);
+std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen, SplitCounts* sc = 0, size_t slot = 0);
+std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen, SplitCounts* sc = 0, size_t slot = 0);
 bool bd_rj(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen);
 #endif
 
@@ -0,0 +1,132 @@
+#include <Rcpp.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "bessel.h"
+
+static std::atomic<bool> bessel_exact(false);
+
+//--------------------------------------------------
+static double log_bessel_k_exact(double nu, double x)
+{
+   thread_local std::vector<double> bk;
+   bk.resize((size_t) nu + 1);
+   return std::log(R::bessel_k_ex(x, nu, 2.0, &bk[0])) - x;
+}
+
+//Abramowitz and Stegun 9.7.8: K_nu(nu z) ~ sqrt(pi/(2 nu)) exp(-nu eta)
+//(1 + z^2)^(-1/4) (1 - u1(t)/nu + u2(t)/nu^2 - ...), t = 1/sqrt(1 + z^2),
+//as in GIGrvg's _unur_bessel_k_nuasympt
+static const double debye_nu = 15.0;
+
+static double log_bessel_k_debye(double nu, double x)
+{
+   double z = x/nu, sz = std::hypot(1., z), t = 1./sz, t2 = t*t;
+   double eta = sz + std::log(z) - std::log1p(sz);
+   double u1t = (t*(3. - 5.*t2))/24.;
+   double u2t = t2*(81. + t2*(-462. + t2*385.))/1152.;
+   double u3t = t*t2*(30375. + t2*(-369603. + t2*(765765. - t2*425425.)))/414720.;
+   double u4t = t2*t2*(4465125. + t2*(-94121676. + t2*(349922430. + t2*(-446185740. + t2*185910725.))))/39813120.;
+   double d = (-u1t + (u2t + (-u3t + u4t/nu)/nu)/nu)/nu;
+   return std::log1p(d) - nu*eta - 0.5*(std::log(2.*nu*sz) - std::log(M_PI));
+}
+
+//--------------------------------------------------
+//log(K_nu(x) e^x) at x = exp(t), t on a grid, with its derivative in t for
+//the Hermite interpolant. scaled so that it is smooth in t at large x too;
+//with a step of 1/64 the interpolation error, of order h^4 / 384 times the
+//fourth derivative in t, is below 1e-9 on the grid's range.
+static const double tab_lo = std::log(1e-6), tab_hi = std::log(1e3), tab_h = 1.0/64;
+static const size_t tab_after = 8;    //calls for an order before it gets a table
+static const size_t max_tables = 512;
+
+struct bessel_table {
+   std::vector<double> f, df;
+
+   explicit bessel_table(double nu) {
+      size_t n = (size_t) std::ceil((tab_hi - tab_lo)/tab_h) + 1;
+      f.resize(n); df.resize(n);
+      for(size_t i=0;i<n;i++) {
+         double x = std::exp(tab_lo + i*tab_h);
+         double k = log_bessel_k_exact(nu, x);
+         double km = log_bessel_k_exact(std::fabs(nu - 1.), x), kp = log_bessel_k_exact(nu + 1., x);
+         f[i] = k + x;
+         //x K'/K + x, K' = -(K_{nu-1} + K_{nu+1})/2
+         df[i] = x - 0.5*x*(std::exp(km - k) + std::exp(kp - k));
+      }
+   }
+   double at(double t) const {
+      double u = (t - tab_lo)/tab_h;
+      size_t i = (size_t) u;
+      if(i + 1 >= f.size()) i = f.size() - 2;
+      double s = u - i, s2 = s*s, s3 = s2*s;
+      return (2*s3 - 3*s2 + 1)*f[i] + (s3 - 2*s2 + s)*tab_h*df[i] +
+             (-2*s3 + 3*s2)*f[i + 1] + (s3 - s2)*tab_h*df[i + 1];
+   }
+};
+
+static std::shared_mutex tab_mtx;
+static std::unordered_map<double, std::shared_ptr<const bessel_table> > tables;
+static std::unordered_map<double, size_t> tab_calls;
+
+static std::shared_ptr<const bessel_table> find_table(double nu)
+{
+   {
+      std::shared_lock<std::shared_mutex> lk(tab_mtx);
+      auto it = tables.find(nu);
+      if(it != tables.end()) return it->second;
+      if(tables.size() >= max_tables) return nullptr;
+   }
+   {
+      std::unique_lock<std::shared_mutex> lk(tab_mtx);
+      //orders that never come back (e.g. tempered counts) aren't kept forever
+      if(tab_calls.size() > 64*max_tables) tab_calls.clear();
+      if(++tab_calls[nu] != tab_after) return nullptr;
+   }
+   //build outside the lock; another thread may do the same, first one wins
+   std::shared_ptr<const bessel_table> tab = std::make_shared<bessel_table>(nu);
+   std::unique_lock<std::shared_mutex> lk(tab_mtx);
+   return tables.emplace(nu, tab).first->second;
+}
+
+//--------------------------------------------------
+double log_bessel_k(double nu, double x)
+{
+   //recent (nu, x) pairs of this thread, direct mapped, with the mode each
+   //value was computed in so a switch to exact isn't served older values
+   struct memo { double nu, x, v; bool exact; };
+   thread_local memo recent[64] = {};
+   bool exact = bessel_exact;
+   uint64_t bn, bx;
+   std::memcpy(&bn, &nu, 8); std::memcpy(&bx, &x, 8);
+   memo& m = recent[((bn ^ (bx*0x9E3779B97F4A7C15ULL)) >> 58) & 63];
+   if(m.nu == nu && m.x == x && m.exact == exact && x > 0) return m.v;
+
+   double v;
+   if(exact) {
+      v = log_bessel_k_exact(nu, x);
+   } else if(nu >= debye_nu) {
+      v = log_bessel_k_debye(nu, x);
+   } else {
+      double t = std::log(x);
+      std::shared_ptr<const bessel_table> tab;
+      if(t >= tab_lo && t <= tab_hi) tab = find_table(nu);
+      v = tab ? tab->at(t) - x : log_bessel_k_exact(nu, x);
+   }
+   m.nu = nu; m.x = x; m.v = v; m.exact = exact;
+   return v;
+}
+
+// [[Rcpp::export]]
+void set_bessel_exact(bool exact)
+{
+   bessel_exact = exact;
+}
@@ -0,0 +1,24 @@
+#ifndef GUARD_bessel_h
+#define GUARD_bessel_h
+
+/*
+log K_nu(x), the modified Bessel function of the second kind, for nu >= 0
+and x > 0, as needed by the GIG normalizing constant (gig_norm) in every
+precision leaf update.
+
+There are three ways to get it:
+   exact    R's bessel_k_ex (scaled, with a per thread work array)
+   Debye    the uniform asymptotic expansion in nu with four terms, for
+            nu >= 15, where its error in log K is below 2e-8
+   tables   for an order that keeps coming back (in the precision updates
+            nu = |n/2 - tau|, so it does), log K_nu on a grid in log x with
+            its derivative, interpolated by cubic Hermite; error in log K
+            below 1e-9 for 1e-6 <= x <= 1e3. outside that, exact.
+and each thread remembers its most recent (nu, x) pairs. set_bessel_exact(true)
+turns the Debye and table paths off.
+*/
+
+double log_bessel_k(double nu, double x);
+void set_bessel_exact(bool exact);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef GUARD_checkpoint_h
+#define GUARD_checkpoint_h
+
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+
+#include "tree.h"
+
+/*
+Binary checkpoint files.
+
+Values are written in native byte order, so a checkpoint is meant to be read
+back on the same kind of machine that wrote it. Trees go through the usual
+text format at full precision. A checkpoint is first written to path + ".tmp"
+and then renamed over path, so a crash while writing leaves the previous
+checkpoint intact.
+*/
+
+//--------------------------------------------------
+class ckpt_out {
+public:
+   ckpt_out(const std::string& path) : path(path), tmp(path + ".tmp"),
+      os(tmp.c_str(), std::ios::binary | std::ios::trunc)
+   {
+      if(!os) throw std::runtime_error("unable to write checkpoint " + tmp);
+   }
+
+   //scalars and other trivially copyable structs
+   template<class T>
+   void put(const T& v) {
+      static_assert(std::is_trivially_copyable<T>::value, "put: not a plain value");
+      os.write((const char*) &v, sizeof(T));
+   }
+   void put(const std::string& s) {
+      put((uint64_t) s.size());
+      os.write(s.data(), s.size());
+   }
+   void put(const tree& t) {
+      std::ostringstream ss;
+      ss << std::setprecision(17) << t;
+      put(ss.str());
+   }
+   template<class T>
+   void put(const std::vector<T>& v) {
+      put((uint64_t) v.size());
+      if constexpr (std::is_trivially_copyable<T>::value) {
+         if(v.size()) os.write((const char*) &v[0], v.size()*sizeof(T));
+      } else {
+         for(size_t i=0;i<v.size();i++) put(v[i]);
+      }
+   }
+   void put(const double* v, size_t n) {
+      os.write((const char*) v, n*sizeof(double));
+   }
+
+   //flush to disk and move into place
+   void commit() {
+      os.close();
+      if(!os) throw std::runtime_error("error writing checkpoint " + tmp);
+      if(std::rename(tmp.c_str(), path.c_str()) != 0) {
+         //rename doesn't replace an existing file on windows
+         std::remove(path.c_str());
+         if(std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("unable to move checkpoint to " + path);
+      }
+   }
+
+private:
+   std::string path, tmp;
+   std::ofstream os;
+};
+
+//--------------------------------------------------
+class ckpt_in {
+public:
+   ckpt_in(const std::string& path) : is(path.c_str(), std::ios::binary)
+   {
+      if(!is) throw std::runtime_error("unable to read checkpoint " + path);
+   }
+
+   template<class T>
+   void get(T& v) {
+      static_assert(std::is_trivially_copyable<T>::value, "get: not a plain value");
+      read((char*) &v, sizeof(T));
+   }
+   void get(std::string& s) {
+      uint64_t n; get(n);
+      s.resize(n);
+      if(n) read(&s[0], n);
+   }
+   void get(tree& t) {
+      std::string s; get(s);
+      std::istringstream ss(s);
+      ss >> t;
+      if(!ss) throw std::runtime_error("corrupt tree in checkpoint");
+   }
+   template<class T>
+   void get(std::vector<T>& v) {
+      uint64_t n; get(n);
+      v.resize(n);
+      if constexpr (std::is_trivially_copyable<T>::value) {
+         if(n) read((char*) &v[0], n*sizeof(T));
+      } else {
+         for(size_t i=0;i<n;i++) get(v[i]);
+      }
+   }
+   void get(double* v, size_t n) {
+      read((char*) v, n*sizeof(double));
+   }
+
+private:
+   std::ifstream is;
+   void read(char* p, size_t n) {
+      is.read(p, n);
+      if(!is) throw std::runtime_error("checkpoint is truncated or corrupt");
+   }
+};
+
+#endif
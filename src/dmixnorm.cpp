@@ -1,13 +1,14 @@
 #include <Rcpp.h>
+#include "isa.h"
 
 using namespace std;
 using namespace Rcpp;
 
-template <class T>
-double logsumexp(T &x) {
+DRBART_CLONES
+static double logsumexp(const std::vector<double> &x) {
   double m = *std::max_element(x.begin(), x.end());
   double s = 0.0;
-  typename T::iterator it;
+  std::vector<double>::const_iterator it;
   for (it = x.begin(); it != x.end(); ++it) {
     s += exp(*it - m);
   }
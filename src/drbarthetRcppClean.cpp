@@ -5,6 +5,9 @@
 #include <vector>
 #include <ctime>
 #include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <memory>
 
 #include "read.h"
 #include "rng.h"
@@ -13,112 +16,352 @@
 #include "funs.h"
 #include "bd.h"
 #include "slice.h"
+#include "backfit.h"
+#include "threads.h"
+#include "checkpoint.h"
+#include "TreeSamples.h"
+#include "ustore.h"
+#include "upartition.h"
+#include "splitcounts.h"
+#include "forestfile.h"
+#include "xfile.h"
 
 #include <chrono>
 
 using namespace Rcpp;
 
-void draw_new_trees(
-  std::vector<tree>& t,
-  xinfo& xi,
-  dinfo& di,
-  double* allfit,
-  double* r,
-  double* ftemp,
-  size_t m,
-  pinfo& pi,
-  RNG& gen,
-  std::vector<tree>& tprec,
-  xinfo& xiprec,
-  dinfo& diprec,
-  double* allfitprec,
-  double* rprec,
-  double* ftempprec,
-  size_t mprec,
-  size_t n,
-  std::vector<double>& y,
-  double phi0,
-  double phistar,
-  pinfo& piprec
-);
-
-void new_u_vals(
-  size_t i,
-  size_t burn,
-  size_t thin,
-  size_t n,
-  size_t p,
-  std::vector<tree>& using_u,
-  std::vector<std::vector<int> >& leaf_counts,
-  std::vector<tree>& using_uprec,
-  std::vector<std::vector<int> >& leaf_countsprec,
-  std::vector<double>& x,
-  std::vector<double>& xprec,
-  double* allfit,
-  double* allfitprec,
-  dinfo& di,
-  dinfo& diprec,
-  xinfo& xi,
-  xinfo& xiprec,
-  bool SCALE_MIX,
-  NumericMatrix& uvals,
-  std::vector<double>& y,
-  ld_bartU& slice_density,
-  std::vector<std::vector<double> >& ucuts_post,
-  size_t m,
-  std::ofstream& treef,
-  std::vector<tree>& t,
-  size_t mprec,
-  std::ofstream& treefprec,
-  std::vector<tree>& tprec,
-  NumericVector& ssigma,
-  double phistar,
-  IntegerVector& trunc_below,
-  NumericVector& y_,
-  tree::npv& bnv,
-  tree::npv& bnvprec,
-  std::vector<tree::npv>& bnvs,
-  std::vector<tree::npv>& bnvsprec
-);
+/*
+One sampler for all three variance models. The iteration is compiled once
+for each variance_mode and for data with and without censored values, so the
+branches on either are resolved at compile time and a constant variance fit
+never touches the precision forest. run_mcmc picks the instance once.
+*/
 
+//censored y (trunc_below[k] > 0: the observed value is a lower bound) are
+//imputed every iteration, which fits without any censoring skip altogether
+enum censoring { UNCENSORED, CENSORED_BELOW };
+
+struct hetero_run;
+
+template<variance_mode V>
+static void draw_new_trees(hetero_run& run, size_t k);
+
+template<variance_mode V>
+static void new_u_vals(hetero_run& run, size_t k);
+
+template<variance_mode V>
+static void impute_censored(hetero_run& run, size_t k);
+
+//state of one chain. a swap move in parallel tempering exchanges two of these
+//between temperatures; dinfo pointers stay valid since vector buffers move along.
+//the precision forest and everything that goes with it stay empty when the
+//variance is constant. x is read in place from run.xdata; u, its first column
+//and the only one the sampler changes, is the chain's own.
+struct hetero_chain {
+  std::vector<tree> t, tprec;
+  std::vector<double> u;
+  std::vector<double*> cols;      //columns of x: u, then those of run.xdata
+  std::vector<double> yimp;       //y with censored values imputed, empty if none are
+  double* y = 0;                  //yimp, or run.y_ when nothing is censored
+  std::vector<double> allfit, r, ftemp;
+  std::vector<double> allfitprec, rprec, ftempprec;
+  dinfo di, diprec;
+
+  //scratch for the u update
+  tree::npv bnv, bnvprec;
+  std::vector<tree::npv> bnvs, bnvsprec;
+  std::vector<leaf_guard> leaf_counts, leaf_countsprec;
+  std::vector<tree> using_u, using_uprec;
+  SplitCounts splits;             //rules of t, then of tprec, see splitcounts.h
+  std::vector<size_t> ucutsv;     //the u partition after the last tree update
+};
+
+//everything the sampler carries from one iteration to the next, which is
+//what a checkpoint has to capture. chains[k] runs at temperature temps[k].
+struct hetero_run {
+  //settings
+  int burn, nd, thin, printevery;
+  int m, mprec;
+  size_t n, p, pprec;
+  double phi0;
+  double nu = 0.0, lambda = 0.0;  //prior on sigma (VAR_CONST) or the precision leaves
+  variance_mode variance;
+  int mean_blocks, prec_blocks;
+  std::vector<double> temps;
+  xinfo xi, xiprec;
+  std::vector<pinfo> pis, piprecs;
+  IntegerVector trunc_below;
+  NumericVector y_;               //y as observed, the bound for censored values
+  NumericVector x_;               //x without u, n x (p - 1) column-major as R has it
+  std::string x_file;             //or the file x is in, see xfile.h; x_ is empty then
+  mapped_x xmap;
+  double* xdata = 0;              //x_ or the mapped file. read only
+  std::string treef_name, treef_prec_name;
+  std::string ckpt_name;          //empty for no checkpoints
+  int ckpt_every;
+  int n_threads = 0;              //threads for the chains and blocks, 0 for one per block of each chain
+  std::unique_ptr<thread_pool> pool;
+
+  //state
+  size_t iter = 0;                //next iteration to run
+  bool talk = false;              //print the diagnostics of this iteration
+  std::vector<hetero_chain> chains;
+  std::vector<RNG> gens;
+  std::vector<std::vector<backfit_block> > blocks, blocksprec;
+  std::vector<int> swap_tries, swap_accepts;
+
+  //output
+  forest_writer treef, treefprec;
+  NumericVector ssigma;           //sigma (VAR_CONST) or phistar of each kept draw
+  UPartition ucuts_post;          //u cut indices of each kept draw
+  std::vector<int> varcount;      //rules on each variable in the mean forest of each kept draw, nd x p by rows
+  std::vector<int> varcountprec;  //and in the precision forest, nd x pprec
+  u_store uvals;                  //what is kept of the u draws, see ustore.h
+};
+
+//log likelihood of the current state of chain k, up to a constant
+template<variance_mode V>
+static double chain_loglik(const hetero_run& run, size_t k)
+{
+  const hetero_chain& c = run.chains[k];
+  double ll = 0.0;
+  if (V == VAR_CONST) {
+    double prec = 1.0 / (run.pis[k].sigma * run.pis[k].sigma);
+    for (size_t i = 0; i < run.n; i++) {
+      double e = c.y[i] - c.allfit[i];
+      ll -= 0.5 * prec * e * e;
+    }
+    return ll + 0.5 * run.n * std::log(prec);
+  }
+  for (size_t i = 0; i < run.n; i++) {
+    double e = c.y[i] - c.allfit[i];
+    ll += 0.5 * std::log(c.allfitprec[i]) - 0.5 * c.allfitprec[i] * e * e;
+  }
+  return ll;
+}
+
+static void setup_run(hetero_run& run, NumericVector y_, NumericVector u_,
+                      NumericVector x_, const std::string& x_file,
+                      List xinfo_list, List xinfo_prec_list,
+                      double alpha, double beta, double kfac,
+                      const std::string& init_treef_name,
+                      const std::string& init_treef_prec_name,
+                      CharacterVector u_output_, CharacterVector u_file_,
+                      bool compact_trees);
+static void run_mcmc(hetero_run& run);
+static List run_output(hetero_run& run);
+static void save_checkpoint(hetero_run& run);
+static void load_checkpoint(hetero_run& run, const std::string& path);
+
+//true if any y is censored
+static bool any_censored(hetero_run& run)
+{
+  return std::find_if(run.trunc_below.begin(), run.trunc_below.end(),
+                      [](int tb) { return tb > 0; }) != run.trunc_below.end();
+}
+
+//point run.xdata at x, mapping its file if it has one. returns the number of
+//values in x
+static size_t attach_x(hetero_run& run)
+{
+  if (run.x_file.empty()) {
+    run.xdata = run.x_.size() ? &run.x_[0] : 0;
+    return run.x_.size();
+  }
+  run.xmap.open(run.x_file);
+  run.xdata = const_cast<double*>(run.xmap.data()); //mapped read only, never written
+  return run.xmap.size();
+}
+
+//size a chain's scratch and point its dinfo at its own u and run.xdata
+static void wire_chain(hetero_chain& c, hetero_run& run)
+{
+  size_t n = run.n;
+
+  c.cols.resize(run.p);
+  c.cols[0] = &c.u[0];
+  for (size_t j = 1; j < run.p; j++) c.cols[j] = run.xdata + (j - 1) * n;
+  c.y = c.yimp.empty() ? &run.y_[0] : &c.yimp[0];
+
+  // dinfo
+  c.r.resize(n); //y-(allfit-ftemp) = y-allfit+ftemp
+  c.ftemp.resize(n); //fit of current tree
+  c.di.n = n;
+  c.di.p = run.p;
+  c.di.cols = &c.cols[0];
+  c.di.y = &c.r[0]; //the y for each draw will be the residual
+  c.leaf_counts.resize(run.m);
+  if (run.variance == VAR_CONST) return;
+
+  //--------------------------------------------------
+  // dinfo for precision
+  c.rprec.resize(n); // scaled residual
+  c.ftempprec.resize(n); //fit of current tree
+  c.diprec.n = n;
+  c.diprec.p = run.pprec;
+  //the same columns, less u when the variance doesn't depend on it
+  c.diprec.cols = c.cols.data() + (run.variance == VAR_UX ? 0 : 1);
+  c.diprec.y = &c.rprec[0]; //the y for each draw will be the residual
+  //end hetero
+
+  c.leaf_countsprec.resize(run.mprec);
+}
+
+//DR-BART-L: constant variance sigma^2 with a scaled inverse chi-square
+//(nu, lambda) prior
 // [[Rcpp::export]]
-List drbartRcppHeteroClean(NumericVector y_, 
-              NumericVector x_, 
-              NumericVector xprec_, 
+List drbart_l(NumericVector y_,
+              NumericVector u_,
+              NumericVector x_,
+              CharacterVector x_file_,
               List xinfo_list,
-              List xinfo_prec_list, 
+              int burn, int nd, int thin, int printevery,
+              int m, double alpha, double beta,
+              double lambda, double nu, double kfac,
+              int mean_blocks,
+              IntegerVector trunc_below,
+              CharacterVector treef_name_,
+              CharacterVector checkpoint_name_,
+              int checkpoint_every,
+              CharacterVector init_treef_name_,
+              CharacterVector u_output_,
+              CharacterVector u_file_,
+              bool compact_trees,
+              int n_threads)
+{
+  hetero_run run;
+  run.burn = burn; run.nd = nd; run.thin = thin; run.printevery = printevery;
+  run.m = m; run.mprec = 0;
+  run.n_threads = n_threads;
+  run.phi0 = 1.0;
+  run.nu = nu; run.lambda = lambda;
+  run.variance = VAR_CONST;
+  run.mean_blocks = mean_blocks; run.prec_blocks = 1;
+  run.temps.assign(1, 1.0);
+  run.trunc_below = trunc_below;
+  run.y_ = y_;
+  run.ckpt_name = as<std::string>(checkpoint_name_);
+  run.ckpt_every = checkpoint_every;
+  run.treef_name = as<std::string>(treef_name_);
+
+  RNGScope scope;
+  setup_run(run, y_, u_, x_, as<std::string>(x_file_), xinfo_list, List(),
+            alpha, beta, kfac, as<std::string>(init_treef_name_), "",
+            u_output_, u_file_, compact_trees);
+  run_mcmc(run);
+  return run_output(run);
+}
+
+// [[Rcpp::export]]
+List drbartRcppHeteroClean(NumericVector y_,
+              NumericVector u_,
+              NumericVector x_,
+              CharacterVector x_file_,
+              List xinfo_list,
+              List xinfo_prec_list,
               int burn, int nd, int thin, int printevery,
               int m, int mprec, double alpha, double beta,
               double nu, double kfac,
-              double phi0, 
+              double phi0,
               bool scalemix,
+              int mean_blocks, int prec_blocks,
+              NumericVector temps,
               IntegerVector trunc_below,
               CharacterVector treef_name_,
-              CharacterVector treef_prec_name_)
+              CharacterVector treef_prec_name_,
+              CharacterVector checkpoint_name_,
+              int checkpoint_every,
+              CharacterVector init_treef_name_,
+              CharacterVector init_treef_prec_name_,
+              CharacterVector u_output_,
+              CharacterVector u_file_,
+              bool compact_trees,
+              int n_threads)
 {
-  
-  bool SCALE_MIX = scalemix;
-  
-  std::string treef_name = as<std::string>(treef_name_); 
-  std::ofstream treef(treef_name.c_str());
-  
-  //begin hetero
-  treef_name = as<std::string>(treef_prec_name_); 
-  std::ofstream treefprec(treef_name.c_str());  
-  //end hetero
-  
-  RNGScope scope;  
-  RNG gen; //this one random number generator is used in all draws
-  
+  hetero_run run;
+  run.burn = burn; run.nd = nd; run.thin = thin; run.printevery = printevery;
+  run.m = m; run.mprec = mprec;
+  run.n_threads = n_threads;
+  run.phi0 = phi0;
+  run.nu = nu; run.lambda = 0.0;
+  run.variance = scalemix ? VAR_UX : VAR_X;
+  run.mean_blocks = mean_blocks; run.prec_blocks = prec_blocks;
+  run.trunc_below = trunc_below;
+  run.y_ = y_;
+  run.ckpt_name = as<std::string>(checkpoint_name_);
+  run.ckpt_every = checkpoint_every;
+
+  run.treef_name = as<std::string>(treef_name_);
+  run.treef_prec_name = as<std::string>(treef_prec_name_);
+
+  RNGScope scope;
+
+  //parallel tempering: chain k targets the prior times the likelihood to the
+  //power temps[k]. temps[0] is 1, and only that chain's draws are kept.
+  if (temps.size() < 1 || temps[0] != 1.0) stop("the first temperature must be 1");
+  run.temps.assign(temps.begin(), temps.end());
+
+  setup_run(run, y_, u_, x_, as<std::string>(x_file_), xinfo_list, xinfo_prec_list,
+            alpha, beta, kfac, as<std::string>(init_treef_name_),
+            as<std::string>(init_treef_prec_name_),
+            u_output_, u_file_, compact_trees);
+  run_mcmc(run);
+  return run_output(run);
+}
+
+//continue a run from a checkpoint written by drbart_l or drbartRcppHeteroClean,
+//appending to its tree files
+// [[Rcpp::export]]
+List drbartRcppHeteroResume(CharacterVector checkpoint_name_, int n_threads)
+{
+  hetero_run run;
+  run.n_threads = n_threads;
+  RNGScope scope;
+  load_checkpoint(run, as<std::string>(checkpoint_name_));
+  run_mcmc(run);
+  return run_output(run);
+}
+
+//data, priors, generators, starting trees and output files of a new run
+//whose settings are filled in
+static void setup_run(hetero_run& run, NumericVector y_, NumericVector u_,
+                      NumericVector x_, const std::string& x_file,
+                      List xinfo_list, List xinfo_prec_list,
+                      double alpha, double beta, double kfac,
+                      const std::string& init_treef_name,
+                      const std::string& init_treef_prec_name,
+                      CharacterVector u_output_, CharacterVector u_file_,
+                      bool compact_trees)
+{
+  bool hetero = run.variance != VAR_CONST;
+  size_t m = run.m, mprec = run.mprec, nd = run.nd;
+
+  //the cold chain draws from R's generator, so with a single temperature
+  //results under set.seed() are as before. heated chains run on their own
+  //threads with their own streams.
+  size_t ntemps = run.temps.size();
+  std::vector<RNG>& gens = run.gens;
+  gens.resize(1);
+
+  //approximate block-parallel tree updates, off when there is one block
+  run.blocks.resize(ntemps);
+  run.blocksprec.resize(ntemps);
+  if (run.mean_blocks > 1) run.blocks[0] = make_blocks(run.mean_blocks);
+  if (run.prec_blocks > 1) run.blocksprec[0] = make_blocks(run.prec_blocks);
+
+  for (size_t k = 1; k < ntemps; k++) {
+    gens.push_back(RNG(draw_seed()));
+    if (run.mean_blocks > 1) run.blocks[k] = make_blocks(run.mean_blocks);
+    if (run.prec_blocks > 1) run.blocksprec[k] = make_blocks(run.prec_blocks);
+  }
+
   /*****************************************************************************
-   Read, format y
+   Read y
   *****************************************************************************/
-  std::vector<double> y; //storage for y
   double miny = INFINITY, maxy = -INFINITY;
   sinfo allys;       //sufficient stats for all of y, use to initialize the bart trees.
-  
+
   for (NumericVector::iterator it = y_.begin(); it != y_.end(); ++it) {
-    y.push_back(*it);
     if (*it < miny) {
       miny = *it;
     }
@@ -130,419 +373,672 @@ List drbartRcppHeteroClean(NumericVector y_,
     allys.sy2 += (*it) * (*it); // sum of y^2
   }
 
-  size_t n = y.size();
+  size_t n = y_.size();
   allys.n = n;
-  
+  run.n = n;
+
   double ybar = allys.sy / n; //sample mean
   double shat = sqrt((allys.sy2 - n * ybar * ybar) / (n - 1)); //sample standard deviation
-  
+
   /*****************************************************************************
-   Read, format X, Xpred
+   Read u, X
   *****************************************************************************/
-  //read x   
-  //the n*p numbers for x are stored as the p for first obs, then p for second, and so on.
-  std::vector<double> x = load_x(x_);
-  size_t p = x.size() / n;
-  
-  std::vector<double> xprec = load_x(xprec_);
-  size_t pprec = xprec.size() / n;
-  
+  //x is used where R keeps it, or in its file, column by column. the variables
+  //are u and then the columns of x; the precision trees see the same less u
+  //unless VAR_UX.
+  run.x_ = x_;
+  run.x_file = x_file;
+  size_t nx = attach_x(run);
+  if ((size_t) u_.size() != n || nx % n != 0) stop("u and x need a row for each y");
+  size_t p = 1 + nx / n;
+  run.p = p;
+
+  size_t pprec = run.variance == VAR_UX ? p : p - 1;
+  run.pprec = pprec;
+
   // cutpoints
-  xinfo xi = load_cutpoints(xinfo_list, p);
-  xinfo xiprec = load_cutpoints(xinfo_prec_list, pprec);
-    
+  run.xi = load_cutpoints(xinfo_list, p);
+  if (hetero) run.xiprec = load_cutpoints(xinfo_prec_list, pprec);
+
   /*****************************************************************************
    Setup for MCMC
   *****************************************************************************/
-  
+  double tleaf = 1.0;//pow(phi0, 1.0/mprec);
+
+  //--------------------------------------------------
+  // prior and mcmc
+  // maybe introduce pb/pbd probs as defaults
+  // maybe pimean and piprec structs derived from a pinfo struct
+  pinfo pi(1.0, 0.5, alpha, beta, miny, maxy, kfac, m, shat);
+  pinfo piprec(1.0, 0.5, alpha, beta, run.nu * mprec, 0.0); // phi_m ~ G(tau, tau)
+  run.pis.assign(ntemps, pi);
+  if (hetero) run.piprecs.assign(ntemps, piprec);
+  for (size_t k = 0; k < ntemps; k++) {
+    run.pis[k].temper = run.temps[k];
+    if (hetero) run.piprecs[k].temper = run.temps[k];
+  }
+  //--------------------------------------------------
+
   //trees
-  
   std::vector<tree> t(m);
   for (size_t i = 0;i < m; i++) {
     t[i].setm(ybar / m); //if you sum the fit over the trees you get the fit.
   }
-  
   std::vector<tree> tprec(mprec);
-  double tleaf = 1.0;//pow(phi0, 1.0/mprec);
   for (size_t i= 0 ; i < mprec; i++) {
     tprec[i].setm(tleaf); //if you sum the fit over the trees you get the fit.
   }
 
-  // n x m matrix for fits
-  NumericMatrix prec_fits(n, m);
-  prec_fits.fill(tleaf);
-  
-  double phistar = phi0;
-  
-  //--------------------------------------------------
-  // prior and mcmc
-  // maybe introduce pb/pbd probs as defaults
-  // maybe pimean and piprec structs derived from a pinfo struct 
-  pinfo pi(1.0, 0.5, alpha, beta, miny, maxy, kfac, m, shat); 
-  pinfo piprec(1.0, 0.5, alpha, beta, nu * mprec, 0.0); // phi_m ~ G(tau, tau)
-  //--------------------------------------------------
-  
-  // dinfo
-  double* allfit = new double[n]; //sum of fit of all trees
-  for (size_t i = 0; i < n; i++) {
-    allfit[i] = ybar;
-  }
-  double* r = new double[n]; //y-(allfit-ftemp) = y-allfit+ftemp
-  double* ftemp = new double[n]; //fit of current tree
-  dinfo di;
-  di.n = n;
-  di.p = p;
-  // di.y = r; //the y for each draw will be the residual
-  
-  // dinfo di(n, p, x);
-  di.x = &x[0];
-  di.y = r;
-  
-  //--------------------------------------------------
-  // dinfo for precision
-  double* allfitprec = new double[n]; //sum of fit of all trees
-  for (size_t i = 0; i < n; i++) {
-    allfitprec[i] = phi0; //phi0 is an "offset"
-  }
-  double* rprec = new double[n]; // scaled residual
-  double* global_rprec = new double[n*m];
-  double* ftempprec = new double[n]; //fit of current tree
-  dinfo diprec;
-  diprec.n = n;
-  diprec.p = pprec;
-  diprec.x = &xprec[0];
-  diprec.y = rprec; //the y for each draw will be the residual
-  //end hetero
-  // dinfo diprec(n, pprec, xprec); 
-  
-  NumericVector ssigma(nd);
-  
-  //save stuff to tree file
-  treef << xi << endl; //cutpoints
-  treef << m << endl;  //number of trees
-  treef << p << endl;  //dimension of x's
-	treef << nd << endl;
-  
-  //begin hetero
-  //save stuff to tree file
-  treefprec << xiprec << endl; //cutpoints
-  treefprec << mprec << endl;  //number of trees
-	treefprec << pprec << endl;  //dimension of x's
-	treefprec << nd << endl;
-  //end hetero
+  //every chain starts from the same state
+  bool censored = any_censored(run);
+  run.chains.resize(ntemps);
+  for (size_t k = 0; k < ntemps; k++) {
+    hetero_chain& c = run.chains[k];
+    c.u.assign(u_.begin(), u_.end());
+    if (censored) c.yimp.assign(y_.begin(), y_.end());
+    wire_chain(c, run);
+  }
 
-  int niters = nd * thin + burn; 
-  
-  /*****************************************************************************
-   MCMC
-  *****************************************************************************/
-  //begin dr bart
-  
-  tree::npv bnv;
-  std::vector<tree::npv> bnvs;
-  std::vector<std::vector<int> > leaf_counts(m);
-  std::vector<double> lik(xi[0].size());
-  std::vector<tree> using_u;
-  std::vector<std::vector<double> > ucuts_post(nd);
-  
-  tree::npv bnvprec;
-  std::vector<tree::npv> bnvsprec;
-  std::vector<std::vector<int> > leaf_countsprec(mprec);
-  //std::vector<double> lik(xiprec[0].size());
-  std::vector<tree> using_uprec;
-  std::vector<std::vector<double> > ucuts_prec_post(nd);
-
-	NumericMatrix uvals(nd, n); 
-  
-  ld_bartU slice_density(0.0, 1.0);
-  slice_density.xi = xi;
-  slice_density.di = di;
-  slice_density.i = 0;
-  slice_density.using_u = using_u;
+  //or warm start from the last draw of an earlier fit, pruned to this data
+  //(x and the initial u, the same in every chain)
+  if (!init_treef_name.empty()) {
+    t = warm_start_trees(init_treef_name, run.xi, m, run.chains[0].di);
+  }
+  if (hetero && !init_treef_prec_name.empty()) {
+    tprec = warm_start_trees(init_treef_prec_name, run.xiprec, mprec, run.chains[0].diprec);
+  }
 
-  slice_density.scalemix = SCALE_MIX;
+  for (size_t k = 0; k < ntemps; k++) {
+    hetero_chain& c = run.chains[k];
+    c.t = t;
+    c.tprec = tprec;
+    c.splits.clear();
+    c.splits.count(c.t);
+    c.splits.count(c.tprec, m);
+    c.allfit.assign(n, ybar); //sum of fit of all trees
+    if (hetero) c.allfitprec.assign(n, run.phi0); //phi0 is an "offset"
 
-  slice_density.xiprec = xiprec;
-  slice_density.diprec = diprec;
-  slice_density.using_uprec = using_uprec;
-  
-  // ld_bartU slice_density(0.0, 1.0, SCALE_MIX);
-  //end dr bart
-  
-  for (size_t i = 0; i < niters; i++) {
-    if (i % printevery == 0) {
-      Rcout << "Iteration " << i << " / " << niters << 
-        " (" << (int) 100 * i / niters << "%)\n";
+    if (!init_treef_name.empty()) {
+      std::fill(c.allfit.begin(), c.allfit.end(), 0.0);
+      for (size_t j = 0; j < m; j++) {
+        fit(c.t[j], run.xi, c.di, &c.ftemp[0]);
+        for (size_t i = 0; i < n; i++) c.allfit[i] += c.ftemp[i];
+      }
+    }
+    if (hetero && !init_treef_prec_name.empty()) {
+      for (size_t j = 0; j < mprec; j++) {
+        fit(c.tprec[j], run.xiprec, c.diprec, &c.ftempprec[0]);
+        for (size_t i = 0; i < n; i++) c.allfitprec[i] *= c.ftempprec[i];
+      }
     }
+  }
+  run.swap_tries.assign(ntemps - 1, 0);
+  run.swap_accepts.assign(ntemps - 1, 0);
+
+  run.ssigma = NumericVector(nd);
+  run.varcount.assign(nd * p, 0);
+  run.varcountprec.assign(hetero ? nd * pprec : 0, 0);
+  run.uvals.init(as<std::string>(u_output_), nd, n, run.xi[0], as<std::string>(u_file_));
+
+  //opened only now, since a warm start may read from these same files
+  run.treef.open(run.treef_name, compact_trees);
+
+  //save stuff to tree file
+  run.treef.header(run.xi, m, p, nd);
+
+  //begin hetero
+  if (hetero) {
+    run.treefprec.open(run.treef_prec_name, compact_trees);
+    run.treefprec.header(run.xiprec, mprec, pprec, nd);
+  }
+  //end hetero
+}
 
-    //double sum_r = 0.0;
-    //for (size_t j = 0; j < n; j++) {
-    //  sum_r += r[j]*r[j];
-    //}
-    //Rcout << "residuals2: " << sum_r << endl;
-
-    auto start = std::chrono::high_resolution_clock::now();
-    draw_new_trees(
-      t, xi, di, allfit, r, ftemp, m, pi, gen,
-      tprec, xiprec, diprec, allfitprec, rprec, ftempprec, mprec, n,
-      y, phi0, phistar, piprec
-    );
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "Execution time draw_new_trees: " << duration.count() << " milliseconds" << std::endl;
+//one iteration of chain k: trees, u, and sigma if it is constant. only the
+//cold chain (k = 0) runs on this thread, talks to R and keeps draws
+template<variance_mode V, censoring C>
+static void step_chain(hetero_run& run, size_t k, size_t i)
+{
+  hetero_chain& c = run.chains[k];
+  bool cold = (k == 0);
+  size_t n = run.n;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  draw_new_trees<V>(run, k);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  if (cold && run.talk) Rcout << "Execution time draw_new_trees: " << duration.count() << " milliseconds" << endl;
 
 //    This is how rg workds (nx is a bot)
 //    int L,U;
 //    L=0; U = xi[v].size()-1;
 //    nx->rg(v,&L,&U);
 //    size_t c = L + floor(gen.uniform()*(U-L+1)); //U-L+1 is number of available split points
-    
-  start = std::chrono::high_resolution_clock::now();
-    new_u_vals(
-      i, burn, thin, n, p, using_u, leaf_counts, using_uprec, leaf_countsprec,
-      x, xprec, allfit, allfitprec, di, diprec, xi, xiprec,
-      SCALE_MIX, uvals, y, slice_density, ucuts_post,
-      m, treef, t, mprec, treefprec, tprec,
-      ssigma, phistar, trunc_below,
-      y_, bnv, bnvprec, bnvs, bnvsprec
-    );
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "Execution time new_u_vals: " << duration.count() << " milliseconds" << std::endl;
 
-    static const double log_sqrt_2pi = 0.9189385332046727; // 0.5*log(2*pi)
+  if (C == CENSORED_BELOW) impute_censored<V>(run, k);
+
+  start = std::chrono::high_resolution_clock::now();
+  new_u_vals<V>(run, k);
+  end = std::chrono::high_resolution_clock::now();
+  duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  if (cold && run.talk) Rcout << "Execution time new_u_vals: " << duration.count() << " milliseconds" << endl;
 
-    double unnorm_loglikelihood_sum = 0.0;
+  if (V == VAR_CONST) {
+    //draw sigma
+    double rss = 0;
     for (size_t j = 0; j < n; j++) {
-      double log_prec = std::log(allfitprec[j]);
-      unnorm_loglikelihood_sum += -log_sqrt_2pi + 0.5 * log_prec - 0.5 * rprec[j] * rprec[j];
+      double restemp = c.y[j] - c.allfit[j];
+      rss += restemp * restemp;
     }
-    Rcout << "Log-likelihood (unnormalized): " << unnorm_loglikelihood_sum << endl;
-
-    // calculate current likelihood
-    // real slow, we stick to the unnormalized likelihood for now
-    /*
-    double lik = 0.0;
-    for (size_t j = 0; j < n; j++)
-    {
-      double original_u = x[j * p];
-      double* x_ptr = &x[j * p]; 
-
-      double mixture_likelihood = 0.0;
-      std::vector<double> log_p(xi[0].size()+1);
-      double usplit;
-      for (int uu = -1; uu < static_cast<int>(xi[0].size()); ++uu) {
-        if (uu == -1) {
-          usplit = xi[0][0] / 2;
-        } else if (uu == xi[0].size() - 1) {
-          usplit = xi[0][uu] + (1 - xi[0][uu]) / 2;
-        } else {
-          usplit = xi[0][uu] + (xi[0][uu + 1] - xi[0][uu]) / 2;
-        }
-        x[j*p] = usplit;
-        double mu = 0.0;
-        for (size_t k = 0; k < m; ++k) {
-          tree::tree_cp tbn = t[k].bn(x_ptr,xi);
-          mu += tbn->getm();
-        }
+    run.pis[k].sigma = sqrt((run.nu * run.lambda + rss) / run.gens[k].chi_square(run.nu + n));
+  }
 
-        double var = 1.0;
-        for (size_t k = 0; k < mprec; ++k) {
-          tree::tree_cp tbn = tprec[k].bn(x_ptr, xiprec);
-          var *= tbn->getm();
-        }
+  size_t burn = run.burn, thin = run.thin;
+  if (cold && i >= burn && i % thin == 0) {
+    size_t d = (i - burn) / thin;
+    run.uvals.record(d, &c.u[0], 1);
+    run.ucuts_post.add_draw(c.ucutsv);
+    run.treef.write(c.t);
+    if (V != VAR_CONST) run.treefprec.write(c.tprec);
+    c.splits.var_counts(&run.varcount[d * run.p], run.p, 0, run.m);
+    if (V != VAR_CONST) c.splits.var_counts(&run.varcountprec[d * run.pprec], run.pprec, run.m, run.mprec);
+
+    run.ssigma(d) = V == VAR_CONST ? run.pis[k].sigma : run.phi0;
+  }
+}
+
+template<variance_mode V, censoring C>
+static void run_mcmc_t(hetero_run& run)
+{
+  size_t n = run.n;
+  size_t ntemps = run.temps.size();
+  size_t niters = run.nd * run.thin + run.burn;
 
-        double prec = 1 / sqrt(var);
-        double diff = y[j] - mu;
-        log_p[uu + 1] = -log_sqrt_2pi - std::log(prec) - 0.5 * (diff * diff) / (prec * prec);        
+  /*****************************************************************************
+   MCMC
+  *****************************************************************************/
 
-        //double ll = R::dnorm(y[j], mu, prec, 1);
+  //swaps proposed/accepted between temperatures k and k + 1
+  std::vector<int>& swap_tries = run.swap_tries;
+  std::vector<int>& swap_accepts = run.swap_accepts;
 
-        //mixture_likelihood += ll;
+  for (size_t i = run.iter; i < niters; i++) {
+    //the heteroskedastic samplers report on every iteration, as they always
+    //have; with constant variance only the progress iterations do
+    run.talk = V != VAR_CONST || i % run.printevery == 0;
+    if (i % run.printevery == 0) {
+      Rcout << "Iteration " << i << " / " << niters <<
+        " (" << (int) 100 * i / niters << "%)\n";
+      if (ntemps > 1) {
+        Rcout << "Swap acceptance:";
+        for (size_t k = 0; k + 1 < ntemps; k++) {
+          Rcout << " " << (swap_tries[k] ? (double) swap_accepts[k] / swap_tries[k] : 0.0);
+        }
+        Rcout << "\n";
       }
-        // Log-sum-exp trick
-      double max_log = *std::max_element(log_p.begin(), log_p.end());
-      double sum_exp = 0.0;
-      for (int k = 0; k < log_p.size(); ++k) {
-        sum_exp += std::exp(log_p[k] - max_log);
+    }
+
+    parallel_blocks(ntemps, [&](size_t k) { step_chain<V, C>(run, k, i); });
+
+    //propose swapping the states of each pair of adjacent temperatures
+    if (ntemps > 1) {
+      std::vector<double> ll(ntemps);
+      for (size_t k = 0; k < ntemps; k++) ll[k] = chain_loglik<V>(run, k);
+      for (size_t k = 0; k + 1 < ntemps; k++) {
+        swap_tries[k]++;
+        double logr = (run.temps[k] - run.temps[k + 1]) * (ll[k + 1] - ll[k]);
+        if (log(run.gens[0].uniform()) < logr) {
+          std::swap(run.chains[k], run.chains[k + 1]);
+          std::swap(run.pis[k].sigma, run.pis[k + 1].sigma); //part of the state with VAR_CONST
+          std::swap(ll[k], ll[k + 1]);
+          swap_accepts[k]++;
+        }
       }
+    }
+
+    run.iter = i + 1;
+    if (!run.ckpt_name.empty() && run.ckpt_every > 0 &&
+        run.iter % run.ckpt_every == 0 && run.iter < niters) {
+      save_checkpoint(run);
+    }
+
+    static const double log_sqrt_2pi = 0.9189385332046727; // 0.5*log(2*pi)
+
+    if (run.talk) {
+      double unnorm_loglikelihood_sum = chain_loglik<V>(run, 0) - n * log_sqrt_2pi;
+      Rcout << "Log-likelihood (unnormalized): " << unnorm_loglikelihood_sum << endl;
+    }
+  }
+  run.treef.close();
+  if (V != VAR_CONST) run.treefprec.close();
+}
+
+//the only place the variance model and censoring are looked at at run time
+static void run_mcmc(hetero_run& run)
+{
+  bool censored = any_censored(run);
+  size_t nt = run.n_threads > 0 ? run.n_threads :
+    run.temps.size() * std::max(run.mean_blocks, run.prec_blocks);
+  run.pool.reset(new thread_pool(nt));
+  pool_scope threads(run.pool.get());
+  switch (run.variance) {
+  case VAR_CONST:
+    if (censored) run_mcmc_t<VAR_CONST, CENSORED_BELOW>(run);
+    else run_mcmc_t<VAR_CONST, UNCENSORED>(run);
+    break;
+  case VAR_X:
+    if (censored) run_mcmc_t<VAR_X, CENSORED_BELOW>(run);
+    else run_mcmc_t<VAR_X, UNCENSORED>(run);
+    break;
+  case VAR_UX:
+    if (censored) run_mcmc_t<VAR_UX, CENSORED_BELOW>(run);
+    else run_mcmc_t<VAR_UX, UNCENSORED>(run);
+    break;
+  }
+}
+
+//v, nd x p by rows, as an nd x p matrix
+static IntegerMatrix count_matrix(const std::vector<int>& v, size_t p)
+{
+  size_t nd = p ? v.size() / p : 0;
+  IntegerMatrix out(nd, p);
+  for (size_t d = 0; d < nd; d++) {
+    for (size_t j = 0; j < p; j++) out(d, j) = v[d * p + j];
+  }
+  return out;
+}
 
-      double log_mix = max_log + std::log(sum_exp) - std::log(log_p.size());
-      lik += log_mix;
-      x[j * p] = original_u;
+static List run_output(hetero_run& run)
+{
+  List out;
+  if (run.variance == VAR_CONST) {
+    out = List::create(_["sigma"] = run.ssigma,
+                       _["ucuts"] = run.ucuts_post.to_list());
+  } else {
+    size_t ntemps = run.temps.size();
+    NumericVector swap_accept(ntemps - 1);
+    for (size_t k = 0; k + 1 < ntemps; k++) {
+      swap_accept[k] = run.swap_tries[k] ? (double) run.swap_accepts[k] / run.swap_tries[k] : 0.0;
     }
-    Rcout << "Current Log-likelihood: " << lik << endl;
-    */
+
+    out = List::create(_["phistar"] = run.ssigma,
+                       _["ucuts"] = run.ucuts_post.to_list(),
+                       _["swap_accept"] = swap_accept);
+  }
+  out.push_back(count_matrix(run.varcount, run.p), "varcount");
+  if (run.variance != VAR_CONST) out.push_back(count_matrix(run.varcountprec, run.pprec), "varcount_prec");
+  run.uvals.add_output(out);
+  out.push_back(thread_stats(*run.pool), "threads");
+  return(out);
+}
+
+/*******************************************************************************
+ Checkpoints
+ 
+ A checkpoint holds the settings, the state of every chain, the rng states,
+ the output so far and the length of each tree file, which is where a resumed
+ run starts appending. It is written after iteration iter - 1 completes.
+*******************************************************************************/
+static const char ckpt_magic[8] = {'D', 'R', 'B', 'C', 'K', 'P', 'T', '5'};
+
+//number of draws kept once iterations 0, ..., iter - 1 are done
+static size_t kept_draws(hetero_run& run)
+{
+  if (run.iter <= (size_t) run.burn) return 0;
+  return std::min((size_t) run.nd, (run.iter - 1 - run.burn) / run.thin + 1);
+}
+
+//version 1 kept a row-major copy of x in every chain, 2 always kept x, 3 had
+//no split counts, 4 could not hold a constant-variance run
+static void check_magic(ckpt_in& in, const std::string& path)
+{
+  char magic[8]; in.get(magic);
+  if (std::equal(magic, magic + 7, ckpt_magic) && magic[7] < ckpt_magic[7])
+    stop("checkpoint written by an older version of drbart, which can't resume it: " + path);
+  if (!std::equal(magic, magic + 8, ckpt_magic)) stop("not a drbart checkpoint: " + path);
+}
+
+static void save_checkpoint(hetero_run& run)
+{
+  //make sure the offsets we record are on disk
+  run.treef.flush();
+  run.treefprec.flush();
+  int64_t treef_len = run.treef.tellp(), treefprec_len = run.treefprec.tellp();
+  
+  //R's generator state, as .Random.seed
+  PutRNGstate();
+  IntegerVector seed = Environment::global_env()[".Random.seed"];
+  
+  ckpt_out out(run.ckpt_name);
+  out.put(ckpt_magic);
+  
+  //what checkpoint_info needs comes first
+  out.put((int) run.variance);
+  out.put(run.treef_name);
+  out.put(run.treef_prec_name);
+  out.put((uint64_t) run.iter);
+  out.put((uint64_t) (run.nd * run.thin + run.burn));
+  
+  //settings
+  out.put(run.burn); out.put(run.nd); out.put(run.thin); out.put(run.printevery);
+  out.put(run.m); out.put(run.mprec);
+  out.put((uint64_t) run.n); out.put((uint64_t) run.p); out.put((uint64_t) run.pprec);
+  out.put(run.phi0);
+  out.put(run.nu); out.put(run.lambda);
+  out.put(run.mean_blocks); out.put(run.prec_blocks);
+  out.put(run.temps);
+  out.put(run.xi); out.put(run.xiprec);
+  out.put(run.pis); out.put(run.piprecs);
+  out.put(std::vector<int>(run.trunc_below.begin(), run.trunc_below.end()));
+  out.put(std::vector<double>(run.y_.begin(), run.y_.end()));
+  out.put(run.x_file);             //a mapped x stays in its file
+  out.put(std::vector<double>(run.x_.begin(), run.x_.end()));
+  out.put(run.ckpt_every);
+  out.put(run.uvals.name()); out.put(run.uvals.file());
+  out.put(run.treef.compact);
+  
+  //chains
+  for (size_t k = 0; k < run.chains.size(); k++) {
+    hetero_chain& c = run.chains[k];
+    out.put(c.t); out.put(c.tprec);
+    out.put(c.u);
+    out.put(c.yimp);
+    out.put(c.allfit); out.put(c.allfitprec);
   }
-  t.clear();
-  delete[] allfit;
-  delete[] r;
-  delete[] ftemp;
+  out.put(run.swap_tries); out.put(run.swap_accepts);
   
-  treef.close();
+  //rngs
+  out.put(std::vector<int>(seed.begin(), seed.end()));
+  for (size_t k = 1; k < run.gens.size(); k++) out.put(run.gens[k].state());
+  for (size_t k = 0; k < run.chains.size(); k++) {
+    out.put((uint64_t) run.blocks[k].size());
+    for (size_t b = 0; b < run.blocks[k].size(); b++) out.put(run.blocks[k][b].gen.state());
+    out.put((uint64_t) run.blocksprec[k].size());
+    for (size_t b = 0; b < run.blocksprec[k].size(); b++) out.put(run.blocksprec[k][b].gen.state());
+  }
+  
+  //output so far
+  size_t kept = kept_draws(run);
+  out.put(&run.ssigma[0], kept);
+  out.put(run.varcount); out.put(run.varcountprec);
+  run.ucuts_post.save(out);
+  run.uvals.save(out, kept);
+  out.put(treef_len); out.put(treefprec_len);
+  run.treef.save(out); run.treefprec.save(out);
   
-  return(List::create(_["phistar"] = ssigma,
-                      _["ucuts"] = ucuts_post,
-											_["uvals"] = uvals));
+  out.commit();
 }
 
-void new_u_vals(
-  size_t i,
-  size_t burn,
-  size_t thin,
-  size_t n,
-  size_t p,
-  std::vector<tree>& using_u,
-  std::vector<std::vector<int> >& leaf_counts,
-  std::vector<tree>& using_uprec,
-  std::vector<std::vector<int> >& leaf_countsprec,
-  std::vector<double>& x,
-  std::vector<double>& xprec,
-  double* allfit,
-  double* allfitprec,
-  dinfo& di,
-  dinfo& diprec,
-  xinfo& xi,
-  xinfo& xiprec,
-  bool SCALE_MIX,
-  NumericMatrix& uvals,
-  std::vector<double>& y,
-  ld_bartU& slice_density,
-  std::vector<std::vector<double> >& ucuts_post,
-  size_t m,
-  std::ofstream& treef,
-  std::vector<tree>& t,
-  size_t mprec,
-  std::ofstream& treefprec,
-  std::vector<tree>& tprec,
-  NumericVector& ssigma,
-  double phistar,
-  IntegerVector& trunc_below,
-  NumericVector& y_,
-  tree::npv& bnv,
-  tree::npv& bnvprec,
-  std::vector<tree::npv>& bnvs,
-  std::vector<tree::npv>& bnvsprec
-) {  
-    double max_prec = 1e10;
-    //begin dr bart
-    
-    // impute censored values
-    for (size_t k = 0; k < n; ++k) {
-      if (trunc_below[k] > 0) {
-        y[k] = rtnormlo(allfit[k], 1.0 / sqrt(allfitprec[k]), y_[k]);// original y_ is obs value
-      }
-    }
-    
-    /*** sample u ***/
-    using_u.clear();
-    leaf_counts.clear();
-    bnvs.clear();
-    vector<std::map<tree::tree_cp,size_t> > bnmaps;
-    std::set<size_t> ucuts; ucuts.insert(0); ucuts.insert(xi[0].size() - 1);
-    std::vector<size_t> using_u_ix, using_u_ix_prec;
-    
-    if (SCALE_MIX) {
-      using_uprec.clear();
-      leaf_countsprec.clear();
-      bnvsprec.clear();
+static void load_blocks(ckpt_in& in, std::vector<backfit_block>& blocks)
+{
+  uint64_t nb; in.get(nb);
+  blocks.clear();
+  for (size_t b = 0; b < nb; b++) {
+    std::string st; in.get(st);
+    blocks.push_back(backfit_block(0));
+    blocks.back().gen.set_state(st);
+  }
+}
+
+static void load_checkpoint(hetero_run& run, const std::string& path)
+{
+  ckpt_in in(path);
+  check_magic(in, path);
+  
+  uint64_t iter, niters, n, p, pprec;
+  int variance;
+  in.get(variance);
+  run.variance = (variance_mode) variance;
+  in.get(run.treef_name);
+  in.get(run.treef_prec_name);
+  in.get(iter); in.get(niters);
+  run.iter = iter;
+  
+  in.get(run.burn); in.get(run.nd); in.get(run.thin); in.get(run.printevery);
+  in.get(run.m); in.get(run.mprec);
+  in.get(n); in.get(p); in.get(pprec);
+  run.n = n; run.p = p; run.pprec = pprec;
+  in.get(run.phi0);
+  in.get(run.nu); in.get(run.lambda);
+  in.get(run.mean_blocks); in.get(run.prec_blocks);
+  in.get(run.temps);
+  in.get(run.xi); in.get(run.xiprec);
+  in.get(run.pis); in.get(run.piprecs);
+  std::vector<int> trunc_below; in.get(trunc_below);
+  run.trunc_below = IntegerVector(trunc_below.begin(), trunc_below.end());
+  std::vector<double> y_; in.get(y_);
+  run.y_ = NumericVector(y_.begin(), y_.end());
+  in.get(run.x_file);
+  std::vector<double> x_; in.get(x_);
+  run.x_ = NumericVector(x_.begin(), x_.end());
+  if (attach_x(run) != n * (p - 1)) stop("covariates have changed since the checkpoint: " + run.x_file);
+  in.get(run.ckpt_every);
+  std::string u_output, u_file;
+  in.get(u_output); in.get(u_file);
+  bool compact_trees; in.get(compact_trees);
+  run.ckpt_name = path;
+  
+  size_t ntemps = run.temps.size();
+  run.chains.resize(ntemps);
+  for (size_t k = 0; k < ntemps; k++) {
+    hetero_chain& c = run.chains[k];
+    in.get(c.t); in.get(c.tprec);
+    c.splits.count(c.t);
+    c.splits.count(c.tprec, run.m);
+    in.get(c.u);
+    in.get(c.yimp);
+    in.get(c.allfit); in.get(c.allfitprec);
+    wire_chain(c, run);
+  }
+  in.get(run.swap_tries); in.get(run.swap_accepts);
+  
+  std::vector<int> seed; in.get(seed);
+  run.gens.resize(1);
+  for (size_t k = 1; k < ntemps; k++) {
+    std::string st; in.get(st);
+    run.gens.push_back(RNG(0));
+    run.gens.back().set_state(st);
+  }
+  run.blocks.resize(ntemps);
+  run.blocksprec.resize(ntemps);
+  for (size_t k = 0; k < ntemps; k++) {
+    load_blocks(in, run.blocks[k]);
+    load_blocks(in, run.blocksprec[k]);
+  }
+  
+  run.ssigma = NumericVector(run.nd);
+  run.uvals.init(u_output, run.nd, run.n, run.xi[0], u_file, true);
+  size_t kept = kept_draws(run);
+  in.get(&run.ssigma[0], kept);
+  in.get(run.varcount); in.get(run.varcountprec);
+  run.ucuts_post.load(in);
+  run.uvals.load(in, kept);
+  int64_t treef_len, treefprec_len;
+  in.get(treef_len); in.get(treefprec_len);
+  run.treef.load(in); run.treefprec.load(in);
+  
+  //drop whatever was written after the checkpoint and carry on from there.
+  //a constant-variance run has no precision tree file
+  bool hetero = run.variance != VAR_CONST;
+  if (std::filesystem::file_size(run.treef_name) < (uintmax_t) treef_len ||
+      (hetero && std::filesystem::file_size(run.treef_prec_name) < (uintmax_t) treefprec_len)) {
+    stop("tree files are shorter than when the checkpoint was written");
+  }
+  std::filesystem::resize_file(run.treef_name, treef_len);
+  run.treef.open(run.treef_name, compact_trees, true);
+  if (hetero) {
+    std::filesystem::resize_file(run.treef_prec_name, treefprec_len);
+    run.treefprec.open(run.treef_prec_name, compact_trees, true);
+  }
+  
+  //put R's generator back where it was
+  Environment::global_env().assign(".Random.seed", IntegerVector(seed.begin(), seed.end()));
+  GetRNGstate();
+}
+
+//the part of a checkpoint R needs to rebuild the drbart object
+// [[Rcpp::export]]
+List checkpoint_info(CharacterVector checkpoint_name_)
+{
+  std::string path = as<std::string>(checkpoint_name_);
+  ckpt_in in(path);
+  check_magic(in, path);
+  
+  int variance;
+  std::string treef_name, treef_prec_name;
+  uint64_t iter, niters;
+  in.get(variance);
+  in.get(treef_name);
+  in.get(treef_prec_name);
+  in.get(iter); in.get(niters);
+  
+  static const char* names[] = {"const", "x", "ux"};
+  return(List::create(_["variance"] = names[variance],
+                      _["mean_file"] = treef_name,
+                      _["prec_file"] = treef_prec_name,
+                      _["iteration"] = (double) iter,
+                      _["niters"] = (double) niters));
+}
+
+//sd of y[i] in chain k, apart from what the precision trees splitting on u add
+template<variance_mode V>
+static inline double obs_sd(const hetero_run& run, const hetero_chain& c, size_t k, size_t i)
+{
+  if constexpr (V == VAR_CONST) return run.pis[k].sigma;
+  else return 1 / sqrt(c.allfitprec[i]);
+}
+
+template<variance_mode V>
+static void impute_censored(hetero_run& run, size_t k)
+{
+  hetero_chain& c = run.chains[k];
+  double temper = run.temps[k];
+  for (size_t i = 0; i < run.n; ++i) {
+    if (run.trunc_below[i] > 0) {
+      // original y_ is obs value
+      c.y[i] = rtnormlo(c.allfit[i], obs_sd<V>(run, c, k, i) / sqrt(temper), run.y_[i], run.gens[k]);
     }
-    vector<std::map<tree::tree_cp,size_t> > bnmapsprec;
-    
-    //get trees splitting on u, the first variable
-    int tsu = 0;
-    for (size_t tt = 0; tt< m ; ++tt) {
-      if (t[tt].nuse(0)) {
-        using_u.push_back(t[tt]);
-        using_u_ix.push_back(tt);
-        tsu++;
-      }
+  }
+}
+
+template<variance_mode V>
+static void new_u_vals(hetero_run& run, size_t k)
+{
+  hetero_chain& c = run.chains[k];
+  size_t n = run.n;
+  size_t m = run.m;
+  xinfo& xi = run.xi;
+  xinfo& xiprec = run.xiprec;
+  dinfo& di = c.di;
+  dinfo& diprec = c.diprec;
+  std::vector<tree>& using_u = c.using_u;
+  std::vector<tree>& using_uprec = c.using_uprec;
+  std::vector<leaf_guard>& leaf_counts = c.leaf_counts;
+  std::vector<leaf_guard>& leaf_countsprec = c.leaf_countsprec;
+  double* allfit = &c.allfit[0];
+  RNG& gen = run.gens[k];
+  bool cold = (k == 0);
+  double max_prec = 1e10;
+  //begin dr bart
+
+  /*** sample u ***/
+  using_u.clear();
+  leaf_counts.clear();
+  c.bnvs.clear();
+  vector<std::map<tree::tree_cp,size_t> > bnmaps;
+
+  if (V == VAR_UX) {
+    using_uprec.clear();
+    leaf_countsprec.clear();
+    c.bnvsprec.clear();
+  }
+  vector<std::map<tree::tree_cp,size_t> > bnmapsprec;
+
+  //get trees splitting on u, the first variable
+  int tsu = 0;
+  for (size_t tt = 0; tt< m ; ++tt) {
+    if (c.splits.nuse(tt, 0)) {
+      using_u.push_back(c.t[tt]);
+      tsu++;
     }
-    Rcout << "Number of mean trees splitting on u: " << tsu << endl;
-    
+  }
+  if (cold && run.talk) Rcout << "Number of mean trees splitting on u: " << tsu << endl;
+
+  if (V == VAR_UX) {
     tsu = 0;
-    if (SCALE_MIX) {
-      for (size_t tt = 0; tt < mprec; ++tt) {
-        if (tprec[tt].nuse(0)) {
-          using_uprec.push_back(tprec[tt]);
-          using_u_ix_prec.push_back(tt);
-          tsu++;
-        }
+    for (size_t tt = 0; tt < (size_t) run.mprec; ++tt) {
+      if (c.splits.nuse(m + tt, 0)) {
+        using_uprec.push_back(c.tprec[tt]);
+        tsu++;
       }
     }
-    Rcout << "Number of var. trees splitting on u: " << tsu << endl;
+    if (cold && run.talk) Rcout << "Number of var. trees splitting on u: " << tsu << endl;
+  }
 
-    //update slice_density object
-    slice_density.using_u = using_u;
-    if (SCALE_MIX) {
-      slice_density.using_uprec = using_uprec;
-    }
-    
-    //get leaf counts for each tree splitting on u & also get partition of u
-    for (size_t tt = 0; tt < using_u.size(); ++tt) {
-      leaf_counts.push_back(counts(using_u[tt], xi, di, bnv)); //clears & populates bnv
-      bnvs.push_back(bnv);
-      using_u[tt].varsplits(ucuts, 0);
+  //slice density of u for the current observation
+  ld_bartU<V> slice_density;
+  slice_density.using_u = &using_u;
+  slice_density.xi = &xi;
+  slice_density.di = &di;
+  slice_density.using_uprec = &using_uprec;
+  slice_density.xiprec = &xiprec;
+  slice_density.diprec = &diprec;
+  slice_density.temper = run.temps[k];
+
+  //get leaf counts for each tree splitting on u
+  for (size_t tt = 0; tt < using_u.size(); ++tt) {
+    leaf_counts.push_back(leaf_guard(counts(using_u[tt], xi, di, c.bnv))); //clears & populates bnv
+    c.bnvs.push_back(c.bnv);
+  }
+
+  if (V == VAR_UX) {
+    for (size_t tt = 0; tt < using_uprec.size(); ++tt) {
+      leaf_countsprec.push_back(leaf_guard(counts(using_uprec[tt], xiprec, diprec, c.bnvprec))); //clears & populates bnv
+      c.bnvsprec.push_back(c.bnvprec);
     }
-    
-    if (SCALE_MIX) {
-      for (size_t tt = 0; tt < using_uprec.size(); ++tt) {
-        leaf_countsprec.push_back(counts(using_uprec[tt], xiprec, diprec, bnvprec)); //clears & populates bnv
-        bnvsprec.push_back(bnvprec);
-        using_uprec[tt].varsplits(ucuts, 0);
-      }
+  }
+
+  //partition of u
+  c.splits.cuts(c.ucutsv, xi[0].size() - 1);
+
+  //prebuild ix->bottom node maps for each tree splitting on u, big time saver.
+  typedef tree::npv::size_type bvsz;
+  for (size_t tt = 0; tt < using_u.size(); ++tt) {
+    std::map<tree::tree_cp,size_t> bnmap;
+    for (bvsz ii = 0;ii != c.bnvs[tt].size(); ii++) {
+      bnmap[c.bnvs[tt][ii]] = ii;
     }
-    std::vector<size_t> ucutsv(ucuts.begin(), ucuts.end());
-    std::vector<double> logpr(ucuts.size() - 1);
+    bnmaps.push_back(bnmap);
+  }
 
-    //prebuild ix->bottom node maps for each tree splitting on u, big time saver.
-    typedef tree::npv::size_type bvsz;
-    for (size_t tt = 0; tt < using_u.size(); ++tt) {
+  if (V == VAR_UX) {
+    for (size_t tt = 0; tt < using_uprec.size(); ++tt) {
       std::map<tree::tree_cp,size_t> bnmap;
-      for (bvsz ii = 0;ii != bnvs[tt].size(); ii++) {
-        bnmap[bnvs[tt][ii]] = ii; 
-      }
-      bnmaps.push_back(bnmap);
-    }
-    
-    if (SCALE_MIX) {
-      for (size_t tt = 0; tt < using_uprec.size(); ++tt) {
-        std::map<tree::tree_cp,size_t> bnmap;
-        for (bvsz ii = 0; ii != bnvsprec[tt].size(); ii++) {
-          bnmap[bnvsprec[tt][ii]] = ii; 
-        }
-        bnmapsprec.push_back(bnmap);
+      for (bvsz ii = 0; ii != c.bnvsprec[tt].size(); ii++) {
+        bnmap[c.bnvsprec[tt][ii]] = ii;
       }
+      bnmapsprec.push_back(bnmap);
     }
+  }
 
-      //loop over each observation
-    std::vector<int> tmpcounts;
-    std::vector<int> tmpcountsprec;
-    std::vector<std::vector<int> > new_counts(using_u.size());
-    size_t jj = 0; //<-- single latent variable for now.
-  for (size_t k = 0; k < n; k++) {
+  //loop over each observation
+  std::vector<size_t> leaf_ix(using_u.size()), leaf_ixprec(using_uprec.size());
+  for (size_t i = 0; i < n; i++) {
     bool proceed = true;
 
-    int L, U;
-    L = 0;
-    U = xi[0].size() - 1;
-
-    //check that removing u won't result in bottom nodes 
+    //check that removing u won't result in bottom nodes with too few obs
     for (size_t tt = 0; tt < using_u.size(); ++tt) {
-      tmpcounts = leaf_counts[tt];
-      update_counts(k, tmpcounts, using_u[tt], xi, di, bnmaps[tt], -1); 
-      new_counts[tt] = tmpcounts;
-      if (*std::min_element(tmpcounts.begin(), tmpcounts.end()) < 5) {
+      leaf_ix[tt] = leaf_index(i, using_u[tt], xi, di, bnmaps[tt]);
+      if (!leaf_counts[tt].can_remove(leaf_ix[tt])) {
         proceed = false;
         break;
       }
     }
 
-    if (SCALE_MIX) {
+    if (V == VAR_UX && proceed) {
       for (size_t tt = 0; tt < using_uprec.size(); ++tt) {
-        tmpcountsprec = leaf_countsprec[tt];
-        update_counts(k, tmpcountsprec, using_uprec[tt], xiprec, diprec, bnmapsprec[tt], -1); 
-        if (*std::min_element(tmpcountsprec.begin(), tmpcountsprec.end()) < 5) {
+        leaf_ixprec[tt] = leaf_index(i, using_uprec[tt], xiprec, diprec, bnmapsprec[tt]);
+        if (!leaf_countsprec[tt].can_remove(leaf_ixprec[tt])) {
           proceed = false;
           break;
         }
@@ -551,188 +1047,246 @@ void new_u_vals(
 
     //resample u
     if (proceed) {
-      leaf_counts = new_counts;
+      for (size_t tt = 0; tt < using_u.size(); ++tt) {
+        leaf_counts[tt].add(leaf_ix[tt], -1);
+      }
 
-      if (SCALE_MIX) {
+      if (V == VAR_UX) {
         for (size_t tt = 0; tt < using_uprec.size(); ++tt) {
-          update_counts(k, leaf_countsprec[tt], using_uprec[tt], xiprec, diprec, bnmapsprec[tt], -1);
+          leaf_countsprec[tt].add(leaf_ixprec[tt], -1);
         }
       }
 
-      double f = allfit[k] - fit_i(k, using_u, xi, di); //fit from trees that don't use u
+      double f = allfit[i] - fit_i(i, using_u, xi, di); //fit from trees that don't use u
       double s;
-      double fprec;
-      if (SCALE_MIX) {
-        fprec = allfitprec[k] / fit_i_mult(k, using_uprec, xiprec, diprec);
+      double fprec = 0.0;
+      if constexpr (V == VAR_UX) {
+        fprec = c.allfitprec[i] / fit_i_mult(i, using_uprec, xiprec, diprec);
         s = 1 / sqrt(fprec);
       } else {
-        s = 1 / sqrt(allfitprec[k]);
+        s = obs_sd<V>(run, c, k, i);
       }
 
       slice_density.sigma = s;
-      slice_density.i = k;
+      slice_density.i = i;
       slice_density.f = f;
-      slice_density.yobs = y[k];
-      double oldu = x[jj + k * p];
-      double newu = slice(oldu, &slice_density, 1.0, INFINITY, 0., 1.);
-      x[jj + k * p] = newu;
-
-      if (SCALE_MIX) {
-        xprec[jj + k * p] = newu;
-      }
+      slice_density.yobs = c.y[i];
+      double oldu = c.u[i];
+      c.u[i] = slice(oldu, slice_density, gen, 1.0, INFINITY, 0., 1.);
 
       //update counts with new u
       for (size_t tt = 0; tt < using_u.size(); ++tt) {
-        update_counts(k, leaf_counts[tt], using_u[tt], xi, di, bnmaps[tt], 1);
+        leaf_counts[tt].add(leaf_index(i, using_u[tt], xi, di, bnmaps[tt]), 1);
       }
       // add back the fit from trees splitting on u
-      allfit[k] = f + fit_i(k, using_u, xi, di);
+      allfit[i] = f + fit_i(i, using_u, xi, di);
 
-      if (SCALE_MIX) {
+      if constexpr (V == VAR_UX) {
         //update counts with new u
         for (size_t tt = 0; tt < using_uprec.size(); ++tt) {
-          update_counts(k, leaf_countsprec[tt], using_uprec[tt], xiprec, diprec, bnmapsprec[tt], 1);
+          leaf_countsprec[tt].add(leaf_index(i, using_uprec[tt], xiprec, diprec, bnmapsprec[tt]), 1);
         }
         // add back the fit from trees splitting on u
-        double new_fitprec = fprec * fit_i_mult(k, using_uprec, xiprec, diprec);
-        allfitprec[k] = std::min(max_prec, new_fitprec);
+        double new_fitprec = fprec * fit_i_mult(i, using_uprec, xiprec, diprec);
+        c.allfitprec[i] = std::min(max_prec, new_fitprec);
       }
     }
-    if (i >= burn && i % thin == 0) {
-      uvals((i - burn) / thin, k) = x[jj + k * p];
-    }
   }
   //end dr bart
-    if (i >= burn & i % thin == 0) {
-// 			for (size_t k = 0; k < n; k++) {
-// 				uvals((i - burn) / thin) = x[jj + k * p];
-//			}
-      for (size_t uu = 0; uu < ucutsv.size(); ++uu) {
-        ucuts_post[(i - burn) / thin].push_back(xi[jj][ucutsv[uu]]);
+}
+
+//sweep over the precision forest of chain k, with the mean forest fixed
+static void draw_prec_trees(hetero_run& run, size_t k)
+{
+  hetero_chain& c = run.chains[k];
+  size_t n = run.n, m = run.m, mprec = run.mprec;
+  xinfo& xiprec = run.xiprec;
+  dinfo& diprec = c.diprec;
+  std::vector<tree>& tprec = c.tprec;
+  double* allfit = &c.allfit[0];
+  double* r = &c.r[0];
+  double* allfitprec = &c.allfitprec[0];
+  double* rprec = &c.rprec[0];
+  double* ftempprec = &c.ftempprec[0];
+  double* y = c.y;
+  pinfo& piprec = run.piprecs[k];
+  RNG& gen = run.gens[k];
+  std::vector<backfit_block>& blocksprec = run.blocksprec[k];
+  bool cold = (k == 0);
+
+    int birth_count_prec = 0; //count of births for precision trees
+    int death_count_prec = 0; //count of deaths for precision trees
+    int birth_accept_prec = 0; //accept/reject count for precision trees
+    int death_accept_prec = 0; //accept/reject count for precision trees
+
+     //begin hetero
+    if (blocksprec.size() > 1) {
+      //approximate: blocks of trees updated concurrently against a stale fit
+      for (size_t i = 0; i < n; i++) {
+        r[i] = y[i] - allfit[i];
       }
-      for (size_t j = 0; j < m;j ++) {
-        treef << t[j] << endl;
+      backfit_prec_blocks(tprec, xiprec, diprec, allfitprec, r, blocksprec,
+        [&](tree& tj, dinfo& dib, backfit_block& bl) {
+          auto [birth_death, accept_reject] = bdprec(tj, xiprec, dib, piprec, bl.gen, &c.splits, m + (&tj - &tprec[0]));
+          bl.tally(birth_death, accept_reject);
+          drphi(tj, xiprec, dib, piprec, bl.gen);
+        });
+      for (size_t b = 0; b < blocksprec.size(); b++) {
+        birth_count_prec += blocksprec[b].birth;
+        death_count_prec += blocksprec[b].death;
+        birth_accept_prec += blocksprec[b].birth_accept;
+        death_accept_prec += blocksprec[b].death_accept;
       }
+    } else {
       for (size_t j = 0; j < mprec; j++) {
-        treefprec << tprec[j] << endl;
+         fit(tprec[j], xiprec, diprec, ftempprec);
+         for (size_t i = 0; i < n; i++) {
+            if (ftempprec[i] != ftempprec[i]) {
+              if (!cold) throw std::runtime_error("nan in ftemp");
+              Rcout << "tree " << j <<" obs "<< i<<" "<< endl;
+              Rcout << tprec[j] << endl;
+              stop("nan in ftemp");
+             }
+            if(cold && ftempprec[i] <= 0) {
+  	          Rcout << "ftempprec <= 0: " << ftempprec[i] << endl;
+  	        }
+            allfitprec[i] = allfitprec[i] / ftempprec[i];
+            rprec[i] = (y[i] - allfit[i]) * sqrt(allfitprec[i]);
+         }
+        auto bdprec_result = bdprec(tprec[j], xiprec, diprec, piprec, gen, &c.splits, m + j);
+        auto [birth_death_prec, accept_reject_prec] = bdprec_result;
+
+        if (birth_death_prec) {
+          birth_count_prec++;
+          if (accept_reject_prec) {
+            birth_accept_prec++;
+          }
+        } else {
+          death_count_prec++;
+          if (accept_reject_prec) {
+            death_accept_prec++;
+          }
+        }
+
+         drphi(tprec[j], xiprec, diprec, piprec, gen);
+         fit(tprec[j], xiprec, diprec, ftempprec);
+         for (size_t i = 0; i < n; i++) {
+          allfitprec[i] *= ftempprec[i];
+        }
       }
-      
-      ssigma((i - burn) / thin) = phistar;
     }
+    //end hetero
+
+    if (!cold) return;
+    Rcout << "Precision Births: " << birth_count_prec << ", Deaths: " << death_count_prec
+          << ", Birth Accepts: " << birth_accept_prec << ", Death Accepts: " << death_accept_prec << endl;
 }
 
-void draw_new_trees(
-  std::vector<tree>& t,
-  xinfo& xi,
-  dinfo& di,
-  double* allfit,
-  double* r,
-  double* ftemp,
-  size_t m,
-  pinfo& pi,
-  RNG& gen,
-  std::vector<tree>& tprec,
-  xinfo& xiprec,
-  dinfo& diprec,
-  double* allfitprec,
-  double* rprec,
-  double* ftempprec,
-  size_t mprec,
-  size_t n,
-  std::vector<double>& y,
-  double phi0,
-  double phistar,
-  pinfo& piprec
-) {
+//sweep over the mean forest of chain k, then the precision forest if there is one
+template<variance_mode V>
+static void draw_new_trees(hetero_run& run, size_t k)
+{
+  hetero_chain& c = run.chains[k];
+  size_t n = run.n, m = run.m;
+  xinfo& xi = run.xi;
+  dinfo& di = c.di;
+  std::vector<tree>& t = c.t;
+  double* allfit = &c.allfit[0];
+  double* r = &c.r[0];
+  double* ftemp = &c.ftemp[0];
+  double* y = c.y;
+  pinfo& pi = run.pis[k];
+  RNG& gen = run.gens[k];
+  std::vector<backfit_block>& blocks = run.blocks[k];
+  bool cold = (k == 0);
+
+  if constexpr (V == VAR_CONST) {
+    //homoscedastic: the usual bart updates with sd pi.sigma
+    if (blocks.size() > 1) {
+      backfit_blocks(t, xi, di, allfit, y, blocks,
+        [&](tree& tj, dinfo& dib, backfit_block& bl) {
+          bd(tj, xi, dib, pi, bl.gen, &c.splits, &tj - &t[0]);
+          drmu(tj, xi, dib, pi, bl.gen);
+        });
+      for (size_t i = 0; i < n; i++) {
+        r[i] = y[i] - allfit[i];
+      }
+    } else {
+      for (size_t j = 0; j < m; j++) {
+        fit(t[j] ,xi, di, ftemp);
+        for (size_t i=0;i<n;i++) {
+          allfit[i] = allfit[i] - ftemp[i];
+          r[i] = y[i] - allfit[i];
+        }
+        bd(t[j], xi, di, pi, gen, &c.splits, j);
+        drmu(t[j], xi, di, pi, gen);
+        fit(t[j], xi, di, ftemp);
+        for (size_t i = 0; i < n; i++) {
+          allfit[i] += ftemp[i];
+        }
+      }
+    }
+  } else {
+    double* allfitprec = &c.allfitprec[0];
 
     //draw trees
     int birth_count = 0; //count of births
     int death_count = 0; //count of deaths
-    int birth_count_prec = 0; //count of births for precision trees
-    int death_count_prec = 0; //count of deaths for precision trees
-
     int birth_accept = 0;
     int death_accept = 0;
-    int birth_accept_prec = 0; //accept/reject count for precision trees
-    int death_accept_prec = 0; //accept/reject count for precision trees
 
-    for (size_t j = 0; j < m; j++) {
-       fit(t[j] ,xi, di, ftemp);
-       for (size_t k=0;k<n;k++) {
-          allfit[k] = allfit[k] - ftemp[k];
-          r[k] = (y[k] - allfit[k]);
-          // di.y[k] = y[k] - allfit[k]; 
-       }
-      auto bdhet_result = bdhet(t[j], xi, di, allfitprec, pi, gen);
-      auto [birth_death, accept_reject] = bdhet_result;
-
-      if (birth_death) {
-        birth_count++;
-        if (accept_reject) {
-          birth_accept++;
-        }
-      } else {
-        death_count++;
-        if (accept_reject) {
-          death_accept++;
-        }
+    if (blocks.size() > 1) {
+      //approximate: blocks of trees updated concurrently against stale residuals
+      backfit_blocks(t, xi, di, allfit, y, blocks,
+        [&](tree& tj, dinfo& dib, backfit_block& bl) {
+          auto [birth_death, accept_reject] = bdhet(tj, xi, dib, allfitprec, pi, bl.gen, &c.splits, &tj - &t[0]);
+          bl.tally(birth_death, accept_reject);
+          drmuhet(tj, xi, dib, allfitprec, pi, bl.gen);
+        });
+      for (size_t b = 0; b < blocks.size(); b++) {
+        birth_count += blocks[b].birth;
+        death_count += blocks[b].death;
+        birth_accept += blocks[b].birth_accept;
+        death_accept += blocks[b].death_accept;
       }
+      for (size_t i = 0; i < n; i++) {
+        r[i] = y[i] - allfit[i];
+      }
+    } else {
+      for (size_t j = 0; j < m; j++) {
+         fit(t[j] ,xi, di, ftemp);
+         for (size_t i=0;i<n;i++) {
+            allfit[i] = allfit[i] - ftemp[i];
+            r[i] = (y[i] - allfit[i]);
+         }
+        auto bdhet_result = bdhet(t[j], xi, di, allfitprec, pi, gen, &c.splits, j);
+        auto [birth_death, accept_reject] = bdhet_result;
 
-       drmuhet(t[j], xi, di, allfitprec, pi, gen);
-       fit(t[j], xi, di, ftemp);
-       for (size_t k = 0; k < n; k++) { 
-         allfit[k] += ftemp[k];
-       }
-    }
-    for (size_t k = 0; k < n; k++) {
-      
-    }
-
-    
-    phistar = phi0;
-    //end hetero
-    
-     //begin hetero
-    for (size_t j = 0; j < mprec; j++) {
-       fit(tprec[j], xiprec, diprec, ftempprec);
-       for (size_t k = 0; k < n; k++) {
-          if (ftempprec[k] != ftempprec[k]) {
-            Rcout << "tree " << j <<" obs "<< k<<" "<< endl;
-            Rcout << tprec[j] << endl;
-            stop("nan in ftemp");
-           }
-          if(ftempprec[k] <= 0) {
-	          Rcout << "ftempprec <= 0: " << ftempprec[k] << endl;
-	        }
-          allfitprec[k] = allfitprec[k] / ftempprec[k];
-          rprec[k] = (y[k] - allfit[k]) * sqrt(allfitprec[k]);
-          // diprec.y[k] = (y[k] - allfit[k]) * sqrt(allfitprec[k]);
-       }
-      auto bdprec_result = bdprec(tprec[j], xiprec, diprec, piprec, gen); 
-      auto [birth_death_prec, accept_reject_prec] = bdprec_result;
-
-      if (birth_death_prec) {
-        birth_count_prec++;
-        if (accept_reject_prec) {
-          birth_accept_prec++;
-        }
-      } else {
-        death_count_prec++;
-        if (accept_reject_prec) {
-          death_accept_prec++;
+        if (birth_death) {
+          birth_count++;
+          if (accept_reject) {
+            birth_accept++;
+          }
+        } else {
+          death_count++;
+          if (accept_reject) {
+            death_accept++;
+          }
         }
-      }
 
-       drphi(tprec[j], xiprec, diprec, piprec, gen);
-       fit(tprec[j], xiprec, diprec, ftempprec);
-       for (size_t k = 0; k < n; k++) {
-        allfitprec[k] *= ftempprec[k];
+         drmuhet(t[j], xi, di, allfitprec, pi, gen);
+         fit(t[j], xi, di, ftemp);
+         for (size_t i = 0; i < n; i++) {
+           allfit[i] += ftemp[i];
+         }
       }
     }
     //end hetero
 
-    Rcout << "Births: " << birth_count << ", Deaths: " << death_count 
-          << ", Birth Accepts: " << birth_accept << ", Death Accepts: " << death_accept << endl;
-    Rcout << "Precision Births: " << birth_count_prec << ", Deaths: " << death_count_prec 
-          << ", Birth Accepts: " << birth_accept_prec << ", Death Accepts: " << death_accept_prec << endl;
-}
\ No newline at end of file
+    if (cold) {
+      Rcout << "Births: " << birth_count << ", Deaths: " << death_count
+            << ", Birth Accepts: " << birth_accept << ", Death Accepts: " << death_accept << endl;
+    }
+    draw_prec_trees(run, k);
+  }
+}
@@ -0,0 +1,19 @@
+#include "flatforest.h"
+#include "isa.h"
+
+//--------------------------------------------------
+DRBART_CLONES
+double flat_forest::fit(const double* x) const
+{
+   double f = 0.0;
+   for(size_t j=0;j<roots.size();j++) f += leaf(roots[j], x);
+   return f;
+}
+
+DRBART_CLONES
+double flat_forest::fit_mult(const double* x) const
+{
+   double f = 1.0;
+   for(size_t j=0;j<roots.size();j++) f *= leaf(roots[j], x);
+   return f;
+}
@@ -0,0 +1,61 @@
+#ifndef GUARD_flatforest_h
+#define GUARD_flatforest_h
+
+#include <cstdint>
+#include <vector>
+
+#include "tree.h"
+
+/*
+A forest copied into one array for evaluation, with the splits on covariates
+that are fixed (the same for every point it will be evaluated at) resolved
+once when it is built. Prediction sweeps usually vary one or two covariates
+and hold the others, so most of each path from the root is taken up front.
+
+Nodes are stored depth first: an interior node's left child follows it and
+right is the index of its right child; right == 0 marks a leaf.
+*/
+class flat_forest {
+public:
+   //fixed[v] != 0 if variable v is fixed, at x0[v]
+   void build(std::vector<tree>& t, xinfo& xi, const std::vector<char>& fixed, const double* x0) {
+      nodes.clear();
+      roots.resize(t.size());
+      for(size_t j=0;j<t.size();j++) {
+         roots[j] = nodes.size();
+         add(&t[j], xi, fixed, x0);
+      }
+   }
+   //sum and product over the trees of the leaf values x falls in. in
+   //flatforest.cpp, built per instruction set (isa.h)
+   double fit(const double* x) const;
+   double fit_mult(const double* x) const;
+
+private:
+   struct fnode {
+      uint32_t v, right;
+      double cut, mu;
+   };
+   std::vector<fnode> nodes;
+   std::vector<uint32_t> roots;
+
+   void add(tree::tree_cp n, xinfo& xi, const std::vector<char>& fixed, const double* x0) {
+      while(n->getl() && fixed[n->getv()])
+         n = x0[n->getv()] < xi[n->getv()][n->getc()] ? n->getl() : n->getr();
+      size_t k = nodes.size();
+      fnode fn;
+      fn.v = n->getv(); fn.right = 0; fn.mu = n->getm();
+      fn.cut = n->getl() ? xi[n->getv()][n->getc()] : 0.0;
+      nodes.push_back(fn);
+      if(!n->getl()) return;
+      add(n->getl(), xi, fixed, x0);
+      nodes[k].right = nodes.size();
+      add(n->getr(), xi, fixed, x0);
+   }
+   double leaf(size_t k, const double* x) const {
+      while(nodes[k].right) k = x[nodes[k].v] < nodes[k].cut ? k + 1 : nodes[k].right;
+      return nodes[k].mu;
+   }
+};
+
+#endif
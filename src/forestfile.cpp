@@ -0,0 +1,263 @@
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "forestfile.h"
+
+const char forest_magic[8] = {'D', 'R', 'B', 'F', 'O', 'R', 'S', '1'};
+
+//--------------------------------------------------
+//little helpers for the compact format
+template<class T>
+static void put(std::string& s, T v)
+{
+   s.append((const char*) &v, sizeof(T));
+}
+
+//read from a record with bounds checking
+struct rec_cursor {
+   const std::string& s;
+   size_t pos;
+   rec_cursor(const std::string& s) : s(s), pos(0) {}
+   template<class T>
+   T get() {
+      if(pos + sizeof(T) > s.size()) throw std::runtime_error("corrupt tree file record");
+      T v;
+      std::memcpy(&v, &s[pos], sizeof(T));
+      pos += sizeof(T);
+      return v;
+   }
+};
+
+//topology of t in getnodes order, leaf values not included
+static void encode_topology(const tree& t, std::string& s)
+{
+   tree::cnpv nds;
+   t.getnodes(nds);
+   s.clear();
+   put(s, (uint32_t) nds.size());
+   for(size_t i=0;i<nds.size();i++) {
+      if(nds[i]->getl()) {
+         put(s, (uint8_t) 1);
+         put(s, (uint32_t) nds[i]->getv());
+         put(s, (uint32_t) nds[i]->getc());
+      } else {
+         put(s, (uint8_t) 0);
+      }
+   }
+}
+
+//--------------------------------------------------
+void forest_writer::open(const std::string& path, bool compact, bool append)
+{
+   this->compact = compact;
+   std::ios::openmode mode = std::ios::out;
+   if(compact) mode |= std::ios::binary;
+   //ate, so tellp gives the file length even before the first write
+   if(append) mode |= std::ios::app | std::ios::ate;
+   os.open(path.c_str(), mode);
+   if(!os) throw std::runtime_error("unable to open tree file " + path);
+   if(!append) ndraws = 0;
+}
+
+void forest_writer::header(const xinfo& xi, size_t m, size_t p, size_t nd)
+{
+   if(!compact) {
+      os << xi << std::endl; //cutpoints
+      os << m << std::endl;  //number of trees
+      os << p << std::endl;  //dimension of x's
+      os << nd << std::endl;
+      return;
+   }
+   rec.clear();
+   rec.append(forest_magic, 8);
+   put(rec, (uint64_t) xi.size());
+   for(size_t v=0;v<xi.size();v++) {
+      put(rec, (uint64_t) xi[v].size());
+      if(xi[v].size()) rec.append((const char*) &xi[v][0], xi[v].size()*sizeof(double));
+   }
+   put(rec, (uint64_t) m);
+   put(rec, (uint64_t) p);
+   put(rec, (uint64_t) nd);
+   put(rec, (uint64_t) keyframe_every);
+   os.write(rec.data(), rec.size());
+   topo.assign(m, std::string());
+}
+
+void forest_writer::write(std::vector<tree>& t)
+{
+   if(!compact) {
+      for(size_t j=0;j<t.size();j++) os << t[j] << std::endl;
+      return;
+   }
+   bool keyframe = ndraws % keyframe_every == 0;
+   topo.resize(t.size());
+   rec.clear();
+   put(rec, (uint8_t) keyframe);
+   tree::npv bots;
+   for(size_t j=0;j<t.size();j++) {
+      encode_topology(t[j], cur);
+      if(keyframe || cur != topo[j]) {
+         put(rec, (uint8_t) 1);
+         rec.append(cur);
+         topo[j].swap(cur);
+      } else {
+         put(rec, (uint8_t) 0);
+      }
+      bots.clear();
+      t[j].getbots(bots);
+      for(size_t k=0;k<bots.size();k++) put(rec, bots[k]->getm());
+   }
+   uint64_t len = rec.size();
+   os.write((const char*) &len, sizeof(len));
+   os.write(rec.data(), rec.size());
+   ndraws++;
+}
+
+void forest_writer::save(ckpt_out& out) const
+{
+   out.put((uint64_t) ndraws);
+   out.put(topo);
+}
+
+void forest_writer::load(ckpt_in& in)
+{
+   uint64_t nd; in.get(nd);
+   ndraws = nd;
+   in.get(topo);
+}
+
+//--------------------------------------------------
+bool forest_reader::open(const std::string& path)
+{
+   if(is.is_open()) is.close();
+   is.clear();
+   is.open(path.c_str(), std::ios::binary);
+   if(!is) return false;
+
+   char magic[8] = {0};
+   is.read(magic, 8);
+   compact = is && std::equal(magic, magic + 8, forest_magic);
+   if(!compact) {
+      is.clear();
+      is.seekg(0);
+      is >> xi; //load the cutpoints
+      is >> m;  //number of trees
+      is >> p;  //dimension of x's
+      is >> ndraws; //number of draws from the posterior that were saved.
+      return (bool) is;
+   }
+
+   uint64_t nv, n;
+   is.read((char*) &nv, sizeof(nv));
+   xi.assign(nv, vec_d());
+   for(size_t v=0;v<nv && is;v++) {
+      is.read((char*) &n, sizeof(n));
+      xi[v].resize(n);
+      if(n) is.read((char*) &xi[v][0], n*sizeof(double));
+   }
+   uint64_t hdr[4];
+   is.read((char*) hdr, sizeof(hdr));
+   m = hdr[0]; p = hdr[1]; ndraws = hdr[2]; keyframe_every = hdr[3];
+   topo.assign(m, std::vector<node_info>());
+   leaves.assign(m, std::vector<size_t>());
+   return (bool) is;
+}
+
+bool forest_reader::next(std::vector<tree>& t)
+{
+   t.resize(m);
+   if(!compact) {
+      for(size_t j=0;j<m;j++) {
+         is >> t[j];
+         if(!is) return false;
+      }
+      return true;
+   }
+
+   uint64_t len;
+   if(!is.read((char*) &len, sizeof(len))) return false;
+   rec.resize(len);
+   if(len && !is.read(&rec[0], len)) return false;
+
+   rec_cursor rc(rec);
+   rc.get<uint8_t>(); //keyframe flag, only needed to seek
+   for(size_t j=0;j<m;j++) {
+      if(rc.get<uint8_t>()) {
+         //new topology. node ids follow from the order: children of id are
+         //2 id and 2 id + 1, and the left subtree comes first
+         size_t nn = rc.get<uint32_t>();
+         std::vector<node_info>& nv = topo[j];
+         nv.resize(nn);
+         leaves[j].clear();
+         std::vector<size_t> ids(1, 1);
+         for(size_t i=0;i<nn;i++) {
+            if(ids.empty()) throw std::runtime_error("corrupt tree in tree file");
+            nv[i].id = ids.back(); ids.pop_back();
+            nv[i].m = 0.0;
+            if(rc.get<uint8_t>()) {
+               nv[i].v = rc.get<uint32_t>();
+               nv[i].c = rc.get<uint32_t>();
+               ids.push_back(2*nv[i].id + 1);
+               ids.push_back(2*nv[i].id);
+            } else {
+               nv[i].v = 0; nv[i].c = 0;
+               leaves[j].push_back(i);
+            }
+         }
+      } else if(topo[j].empty()) {
+         throw std::runtime_error("tree file draw refers to a missing topology");
+      }
+      for(size_t k=0;k<leaves[j].size();k++) topo[j][leaves[j][k]].m = rc.get<double>();
+      t[j].fromnodes(topo[j]);
+   }
+   return true;
+}
+
+std::vector<int64_t> forest_reader::index()
+{
+   std::vector<int64_t> offsets;
+   if(!compact) {
+      //a tree is its number of nodes, then a line per node
+      for(size_t i=0;i<ndraws;i++) {
+         is >> std::ws;
+         int64_t off = is.tellg();
+         for(size_t j=0;j<m;j++) {
+            size_t nn;
+            is >> nn;
+            for(size_t k=0;k<=nn && is;k++) is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+         }
+         if(!is || is.eof()) break; //incomplete
+         offsets.push_back(off);
+      }
+   } else {
+      int64_t start = is.tellg();
+      is.seekg(0, std::ios::end);
+      int64_t size = is.tellg();
+      int64_t off = start;
+      for(size_t i=0;i<ndraws;i++) {
+         uint64_t len;
+         is.seekg(off);
+         if(!is.read((char*) &len, sizeof(len))) break;
+         if(off + (int64_t) (sizeof(len) + len) > size) break; //incomplete
+         offsets.push_back(off);
+         off += sizeof(len) + len;
+      }
+   }
+   is.clear();
+   return offsets;
+}
+
+void forest_reader::seek(const std::vector<int64_t>& offsets, size_t i)
+{
+   is.clear();
+   if(!compact) {
+      is.seekg(offsets[i]);
+      return;
+   }
+   size_t k = i - i % keyframe_every;
+   is.seekg(offsets[k]);
+   for(; k<i; k++) {
+      if(!next(scratch)) throw std::runtime_error("corrupt tree file");
+   }
+}
@@ -0,0 +1,94 @@
+#ifndef GUARD_forestfile_h
+#define GUARD_forestfile_h
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tree.h"
+#include "checkpoint.h"
+
+/*
+Tree files: the posterior draws of a forest, one draw of m trees after another.
+
+The text format is the original one: the cutpoints, m, p and the number of
+draws, then every node of every tree of every draw.
+
+The compact format is binary (native byte order) and uses the fact that
+between kept draws most trees keep their topology and only get new leaf
+values. After the magic and a header (cutpoints, m, p, number of draws,
+keyframe interval) come length-prefixed draw records:
+   uint64 record length (bytes after this field)
+   uint8  1 if keyframe
+   for each tree:
+      uint8 1 if its topology follows, 0 if it is the same as last draw
+      [topology: uint32 number of nodes, then in getnodes order uint8 1 for
+       an interior node followed by uint32 v, uint32 c, or uint8 0 for a leaf]
+      the leaf values as doubles, left to right
+Every keyframe_every-th draw writes all topologies, so a draw can be decoded
+starting from the keyframe at or before it. The mu of interior nodes, which
+nothing uses, is not stored and reads back as 0.
+*/
+
+extern const char forest_magic[8];
+
+//--------------------------------------------------
+class forest_writer {
+public:
+   forest_writer() : compact(false), keyframe_every(64), ndraws(0) {}
+
+   //append: reopen a file being resumed from a checkpoint, header already there
+   void open(const std::string& path, bool compact, bool append=false);
+   void header(const xinfo& xi, size_t m, size_t p, size_t nd);
+   void write(std::vector<tree>& t);
+
+   void flush() { os.flush(); }
+   int64_t tellp() { return os.tellp(); }
+   void close() { os.close(); }
+
+   //what the writer needs to carry on after a checkpoint
+   void save(ckpt_out& out) const;
+   void load(ckpt_in& in);
+
+   bool compact;
+   size_t keyframe_every;
+
+private:
+   std::ofstream os;
+   size_t ndraws;                 //draws written so far
+   std::vector<std::string> topo; //encoded topology of each tree in the last draw
+   std::string rec, cur;          //scratch
+};
+
+//--------------------------------------------------
+//reads either format, a draw at a time
+class forest_reader {
+public:
+   forest_reader() : compact(false), m(0), p(0), ndraws(0), keyframe_every(0) {}
+
+   //open and read the header; false if the file can't be read
+   bool open(const std::string& path);
+   //the next draw, false at the end of the file or at an incomplete draw
+   bool next(std::vector<tree>& t);
+
+   //file offsets of the complete draws, found by skipping through the file
+   //once without building any trees. call right after open.
+   std::vector<int64_t> index();
+   //make draw i the one next() reads. in the compact format that means
+   //decoding from the keyframe at or before draw i.
+   void seek(const std::vector<int64_t>& offsets, size_t i);
+
+   bool compact;
+   xinfo xi;
+   size_t m, p, ndraws, keyframe_every;
+
+private:
+   std::ifstream is;
+   std::vector<std::vector<node_info> > topo; //nodes of each tree in the last draw
+   std::vector<std::vector<size_t> > leaves;  //where its leaves are in topo
+   std::string rec;
+   std::vector<tree> scratch;
+};
+
+#endif
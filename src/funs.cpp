@@ -1,5 +1,10 @@
 #include <cmath>
+#include <sstream>
+#include <stdexcept>
 #include "funs.h"
+#include "gig.h"
+#include "threads.h"
+#include "isa.h"
 #include <map>
 #ifdef MPIBART
 #include "mpi.h"
@@ -108,11 +113,12 @@ double pgrow(tree::tree_p n, xinfo& xi, pinfo& pi)
 }
 //--------------------------------------------------
 //get sufficients stats for all bottom nodes
+DRBART_CLONES
 void allsuff(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv, std::vector<sinfo>& sv)
 {
 	tree::tree_cp tbn; //the pointer to the bottom node for the current observations
 	size_t ni;         //the  index into vector of the current bottom node
-	double *xx;        //current x
+	xrow xx;        //current x
 	double y;          //current y
 	
 	bnv.clear();
@@ -126,7 +132,7 @@ void allsuff(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv, std::vector<sinfo>&
 	for(bvsz i=0;i!=bnv.size();i++) bnmap[bnv[i]]=i;
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		y=di.y[i];
 		
 		tbn = x.bn(xx,xi);
@@ -138,11 +144,12 @@ void allsuff(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv, std::vector<sinfo>&
 	}
 }
 
+DRBART_CLONES
 void allsuffhet(tree& x, xinfo& xi, dinfo& di, double* phi, tree::npv& bnv, std::vector<sinfo>& sv)
 {
   tree::tree_cp tbn; //the pointer to the bottom node for the current observations
 	size_t ni;         //the  index into vector of the current bottom node
-	double *xx;        //current x
+	xrow xx;        //current x
 	double y;          //current y
 	
 	bnv.clear();
@@ -156,7 +163,7 @@ void allsuffhet(tree& x, xinfo& xi, dinfo& di, double* phi, tree::npv& bnv, std:
 	for(bvsz i=0;i!=bnv.size();i++) bnmap[bnv[i]]=i;
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		y=di.y[i];
 		
 		tbn = x.bn(xx,xi);
@@ -178,7 +185,7 @@ std::vector<int> counts(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv)
 {
   tree::tree_cp tbn; //the pointer to the bottom node for the current observations
 	size_t ni;         //the  index into vector of the current bottom node
-	double *xx;        //current x
+	xrow xx;        //current x
 	double y;          //current y
   
 	bnv.clear();
@@ -193,7 +200,7 @@ std::vector<int> counts(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv)
 	for(bvsz i=0;i!=bnv.size();i++) bnmap[bnv[i]]=i;
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		y=di.y[i];
 		
 		tbn = x.bn(xx,xi);
@@ -211,7 +218,7 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi,
 {
   tree::tree_cp tbn; //the pointer to the bottom node for the current observations
   size_t ni;         //the  index into vector of the current bottom node
-	double *xx;        //current x
+	xrow xx;        //current x
 	double y;          //current y
 
 	typedef tree::npv::size_type bvsz;
@@ -220,7 +227,7 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi,
 	std::map<tree::tree_cp,size_t> bnmap;
 	for(bvsz ii=0;ii!=bnv.size();ii++) bnmap[bnv[ii]]=ii; // bnmap[pointer] gives linear index
 	
-	xx = di.x + i*di.p;
+	xx = di.row(i);
 	y=di.y[i];
 	
 	tbn = x.bn(xx,xi);
@@ -236,7 +243,7 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi,
 {
   tree::tree_cp tbn; //the pointer to the bottom node for the current observations
   size_t ni;         //the  index into vector of the current bottom node
-  double *xx;        //current x
+  xrow xx;        //current x
 	double y;          //current y
   /*
 	typedef tree::npv::size_type bvsz;
@@ -245,7 +252,7 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi,
 	std::map<tree::tree_cp,size_t> bnmap;
 	for(bvsz ii=0;ii!=bnv.size();ii++) bnmap[bnv[ii]]=ii; // bnmap[pointer] gives linear index
 	*/
-	xx = di.x + i*di.p;
+	xx = di.row(i);
 	y=di.y[i];
 	
 	tbn = x.bn(xx,xi);
@@ -264,7 +271,7 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi,
 {
   //tree::tree_cp tbn; //the pointer to the bottom node for the current observations
   size_t ni;         //the  index into vector of the current bottom node
-  double *xx;        //current x
+  xrow xx;        //current x
   double y;          //current y
   /*
 	typedef tree::npv::size_type bvsz;
@@ -273,7 +280,7 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi,
 	std::map<tree::tree_cp,size_t> bnmap;
 	for(bvsz ii=0;ii!=bnv.size();ii++) bnmap[bnv[ii]]=ii; // bnmap[pointer] gives linear index
 	*/
-	xx = di.x + i*di.p;
+	xx = di.row(i);
 	y=di.y[i];
 	
 	tbn = x.bn(xx,xi);
@@ -282,6 +289,11 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi,
   cts[ni] += sign;
 }
 
+size_t leaf_index(int i, tree& x, xinfo& xi, dinfo& di, std::map<tree::tree_cp,size_t>& bnmap)
+{
+  return bnmap[x.bn(di.row(i), xi)];
+}
+
 bool min_leaf(int minct, std::vector<tree>& t, xinfo& xi, dinfo& di) {
   bool good = true;
   tree::npv bnv;
@@ -340,7 +352,7 @@ void MPIslaveallsuff(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv)
 {
 	tree::tree_cp tbn; //the pointer to the bottom node for the current observations
 	size_t ni;         //the  index into vector of the current bottom node
-	double *xx;        //current x
+	xrow xx;        //current x
 	double y;          //current y
 	
 	bnv.clear();
@@ -365,7 +377,7 @@ void MPIslaveallsuff(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv)
 	}
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		y=di.y[i];
 		
 		tbn = x.bn(xx,xi);
@@ -388,15 +400,16 @@ void MPIslaveallsuff(tree& x, xinfo& xi, dinfo& di, tree::npv& bnv)
 #endif
 //--------------------------------------------------
 //get sufficient stats for children (v,c) of node nx in tree x
+DRBART_CLONES
 void getsuff(tree& x, tree::tree_cp nx, size_t v, size_t c, xinfo& xi, dinfo& di, sinfo& sl, sinfo& sr)
 {
-	double *xx;//current x
+	xrow xx;//current x
 	double y;  //current y
 	sl.n=0;sl.sy=0.0;sl.sy2=0.0;
 	sr.n=0;sr.sy=0.0;sr.sy2=0.0;
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		if(nx==x.bn(xx,xi)) { //does the bottom node = xx's bottom node
 			y = di.y[i];
 			if(xx[v] < xi[v][c]) {
@@ -412,15 +425,16 @@ void getsuff(tree& x, tree::tree_cp nx, size_t v, size_t c, xinfo& xi, dinfo& di
 	}
 }
 //for het, n = sum_i phi_i, sumy = \sum \phi_iy_i, sumy^2 \sum \phi_iy_i^2
+DRBART_CLONES
 void getsuffhet(tree& x, tree::tree_cp nx, size_t v, size_t c, xinfo& xi, dinfo& di, double* phi, sinfo& sl, sinfo& sr)
 {
-  double *xx;//current x
+  xrow xx;//current x
 	double y;  //current y
 	sl.n=0;sl.sy=0.0;sl.sy2=0.0;sl.n0=0;
 	sr.n=0;sr.sy=0.0;sr.sy2=0.0;sr.n0=0;
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		if(nx==x.bn(xx,xi)) { //does the bottom node = xx's bottom node
 			y = di.y[i];
 			if(xx[v] < xi[v][c]) {
@@ -440,15 +454,16 @@ void getsuffhet(tree& x, tree::tree_cp nx, size_t v, size_t c, xinfo& xi, dinfo&
 
 //--------------------------------------------------
 //get sufficient stats for pair of bottom children nl(left) and nr(right) in tree x
+DRBART_CLONES
 void getsuff(tree& x, tree::tree_cp nl, tree::tree_cp nr, xinfo& xi, dinfo& di, sinfo& sl, sinfo& sr)
 {
-	double *xx;//current x
+	xrow xx;//current x
 	double y;  //current y
 	sl.n=0;sl.sy=0.0;sl.sy2=0.0;
 	sr.n=0;sr.sy=0.0;sr.sy2=0.0;
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		tree::tree_cp bn = x.bn(xx,xi);
 		if(bn==nl) {
 			y = di.y[i];
@@ -464,15 +479,16 @@ void getsuff(tree& x, tree::tree_cp nl, tree::tree_cp nr, xinfo& xi, dinfo& di,
 		}
 	}
 }
+DRBART_CLONES
 void getsuffhet(tree& x, tree::tree_cp nl, tree::tree_cp nr, xinfo& xi, dinfo& di, double* phi, sinfo& sl, sinfo& sr)
 {
-  double *xx;//current x
+  xrow xx;//current x
 	double y;  //current y
 	sl.n=0;sl.sy=0.0;sl.sy2=0.0;
 	sr.n=0;sr.sy=0.0;sr.sy2=0.0;
 	
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		tree::tree_cp bn = x.bn(xx,xi);
 		if(bn==nl) {
 			y = di.y[i];
@@ -771,25 +787,27 @@ double lilprec(double n, double sy, double sy2, double sigma, double tau)
 }
 //--------------------------------------------------
 //fit
+DRBART_CLONES
 void fit(tree& t, xinfo& xi, dinfo& di, std::vector<double>& fv)
 {
-	double *xx;
+	xrow xx;
 	tree::tree_cp bn;
 	fv.resize(di.n);
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		bn = t.bn(xx,xi);
 		fv[i] = bn->getm();
 	}
 }
 //--------------------------------------------------
 //fit
+DRBART_CLONES
 void fit(tree& t, xinfo& xi, dinfo& di, double* fv)
 {
-	double *xx;
+	xrow xx;
 	tree::tree_cp bn;
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		bn = t.bn(xx,xi);
 		fv[i] = bn->getm();
 	}
@@ -799,11 +817,11 @@ void fit(tree& t, xinfo& xi, dinfo& di, double* fv)
 //partition
 void partition(tree& t, xinfo& xi, dinfo& di, std::vector<size_t>& pv)
 {
-	double *xx;
+	xrow xx;
 	tree::tree_cp bn;
 	pv.resize(di.n);
 	for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		bn = t.bn(xx,xi);
 		pv[i] = bn->nid();
 	}
@@ -827,13 +845,16 @@ void drmu(tree& t, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
 		double tmp = b * ybar / (a + b) + gen.normal() / sqrt(a + b);
 		bnv[i]->setm(tmp);
     if (bnv[i]->getm() != bnv[i]->getm()) {
-    	Rcout << " tmp " << tmp;
-    	Rcout << " bnv[i] " << bnv[i]->getm();
-      for (int i = 0; i < di.n; ++i) Rcout << *(di.x + i * di.p) << " "; //*(x + p*i+j)
-      Rcout << endl << " a " << a << " b " << b << " svi[n] " << sv[i].n << " i " << i;
-      Rcout << endl << di.p;
-      Rcout << endl << t;
-      Rcpp::stop("drmu failed");
+      //may be off R's thread, see threads.h
+      std::ostringstream msg;
+    	msg << " tmp " << tmp;
+    	msg << " bnv[i] " << bnv[i]->getm();
+      for (size_t ii = 0; ii < di.n; ++ii) msg << di.at(ii, 0) << " "; //*(x + p*i+j)
+      msg << endl << " a " << a << " b " << b << " svi[n] " << sv[i].n << " i " << i;
+      msg << endl << di.p;
+      msg << endl << t;
+      thread_message(msg.str());
+      throw std::runtime_error("drmu failed");
     }
 	}
 }
@@ -843,6 +864,7 @@ void drmuhet(tree& t, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen)
   tree::npv bnv;
 	std::vector<sinfo> sv;
 	allsuffhet(t,xi,di,phi,bnv,sv);
+	for(size_t i=0;i<sv.size();i++) temper(sv[i], pi.temper);
 	
 	double a = 1.0/(pi.tau * pi.tau);
 	double sig2 = pi.sigma * pi.sigma;
@@ -857,10 +879,12 @@ void drmuhet(tree& t, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen)
 	if (!std::isnan(new_mean)) {
 		bnv[i]->setm(new_mean);
 	} else {
-		Rcout << "Warning: NaN detected in drmuhet for node " << i 
+		std::ostringstream msg;
+		msg << "Warning: NaN detected in drmuhet for node " << i 
 					<< ", skipping update (fcmean=" << fcmean 
 					<< ", fcvar=" << fcvar << ")" << endl;
-      //for(int ii=0; ii<di.n; ++ii) Rcout << *(di.x + ii*di.p) <<" "; //*(x + p*i+j)
+		thread_message(msg.str());
+      //for(int ii=0; ii<di.n; ++ii) Rcout << di.at(ii, 0) <<" "; //*(x + p*i+j)
       //Rcout << endl<<" a "<< a<<" b "<<b<<" svi[n] "<<sv[i].n<<" i "<<i;
       //Rcout << endl<<" svi[n0] " << sv[i].n0 << endl;
       //Rcout << endl << t;
@@ -874,15 +898,19 @@ void drphi(tree& t, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
   tree::npv bnv;
 	std::vector<sinfo> sv;
 	allsuff(t,xi,di,bnv,sv);
+	for(size_t i=0;i<sv.size();i++) temper(sv[i], pi.temper);
 	
+	//pick the mixture component of each leaf, drawing the gamma ones now and
+	//collecting the parameters of the gig ones to draw together
+	std::vector<double> mus(bnv.size()), lam, chi, psi;
+	std::vector<size_t> gi;
 	for(tree::npv::size_type i=0;i!=bnv.size();i++) {
 		//gamma prior
 		//double mu = gen.gamma(0.5*sv[i].n + pi.tau, 1.0)/(0.5*sv[i].sy2 + pi.tau);
-		double mu;
 		double tau = pi.tau, n = sv[i].n, sy2 = sv[i].sy2;
 		
 		// Add epsion to sy2 to prevent it from being exactly zero
-		// Because this would cause the do_rgig1 function to fail
+		// Because this would cause the gig draw to fail
 		if (sy2 < 1e-8) sy2 = 1e-8;
 
 		//compute weights
@@ -892,31 +920,43 @@ void drphi(tree& t, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen)
 		double logapb = logsumexp(loga, logb);
 		if(log(gen.uniform()) < loga-logapb) {
 			//gamma
-			mu = gen.gamma(ga, 1.0)/gb;
+			mus[i] = gen.gamma(ga, 1.0)/gb;
 		} else {
 			//gig
-			mu = do_rgig1(0.5*n-tau, 2.0*tau, sy2);
+			gi.push_back(i);
+			lam.push_back(0.5*n-tau);
+			chi.push_back(2.0*tau);
+			psi.push_back(sy2);
 		}
-		
+	}
+	std::vector<double> g(gi.size());
+	if(gi.size()) gig_draws(gi.size(), &lam[0], &chi[0], &psi[0], gen, &g[0]);
+	for(size_t k=0;k<gi.size();k++) mus[gi[k]] = g[k];
+	
+	for(tree::npv::size_type i=0;i!=bnv.size();i++) {
+		double mu = mus[i];
 
 		// clip precision to avoid numerical issues
 		if(mu < 1e-8) mu = 1e-8;
 		
 		bnv[i]->setm(mu);
 		if(bnv[i]->getm() != bnv[i]->getm()) {
-			for(int ii=0; ii<di.n; ++ii) Rcout << *(di.x + ii*di.p) <<" "; //*(x + p*i+j)
-			Rcout << endl<<" svi[n] "<<sv[i].n<<" i "<<i;
-			Rcout << endl << t;
-			Rcpp::stop("drmu failed");
+			std::ostringstream msg;
+			for(size_t ii=0; ii<di.n; ++ii) msg << di.at(ii, 0) <<" "; //*(x + p*i+j)
+			msg << endl<<" svi[n] "<<sv[i].n<<" i "<<i;
+			msg << endl << t;
+			thread_message(msg.str());
+			throw std::runtime_error("drmu failed");
 		}
 
 		if(bnv[i]->getm() <= 0) {
-			Rcout << "drphi : bnv[i]->getm() <= 0: " << bnv[i]->getm() << mu << endl;
+			std::ostringstream msg;
+			msg << "drphi : bnv[i]->getm() <= 0: " << bnv[i]->getm() << mu << endl;
+			thread_message(msg.str());
 		}
 	}
 }
 
-
 #ifdef MPIBART
 //-----------------------------------------------------
 // Draw all the bottom node mu's -- slave code for the MPI version
@@ -76,6 +76,34 @@ void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi, dinfo& di,
 
 void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi, dinfo& di, std::map<tree::tree_cp,size_t>& bnmap, int sign);
 void update_counts(int i, std::vector<int>& cts, tree& x, xinfo& xi, dinfo& di, std::map<tree::tree_cp,size_t>& bnmap, int sign, tree::tree_cp &tbn);
+//index (into the bnv bnmap was built from) of the bottom node of observation i
+size_t leaf_index(int i, tree& x, xinfo& xi, dinfo& di, std::map<tree::tree_cp,size_t>& bnmap);
+
+//--------------------------------------------------
+//smallest leaf the u update may leave behind, as births require of new leaves
+const int min_leaf_obs = 5;
+
+//bottom node counts of a tree for the u update, with the number of leaves
+//below min_leaf_obs, so whether an observation may leave its leaf is O(1)
+//and moving it is an update in place
+class leaf_guard {
+public:
+   leaf_guard() : nbelow(0) {}
+   explicit leaf_guard(const std::vector<int>& c) : cts(c), nbelow(0) {
+      for(size_t i=0;i<cts.size();i++) nbelow += cts[i] < min_leaf_obs;
+   }
+   //removing an observation from leaf would leave every leaf big enough
+   bool can_remove(size_t leaf) const {return nbelow == 0 && cts[leaf] > min_leaf_obs;}
+   void add(size_t leaf, int sign) {
+      int below = cts[leaf] < min_leaf_obs;
+      cts[leaf] += sign;
+      nbelow += (cts[leaf] < min_leaf_obs) - below;
+   }
+   const std::vector<int>& counts() const {return cts;}
+private:
+   std::vector<int> cts;
+   int nbelow;
+};
 
 //--------------------------------------------------
 //check minimum leaf size
@@ -88,6 +116,10 @@ void getsuffhet(tree& x, tree::tree_cp nx, size_t v, size_t c, xinfo& xi, dinfo&
 //get sufficient stats for pair of bottom children nl(left) and nr(right) in tree x
 void getsuff(tree& x, tree::tree_cp nl, tree::tree_cp nr, xinfo& xi, dinfo& di, sinfo& sl, sinfo& sr);
 void getsuffhet(tree& x, tree::tree_cp nl, tree::tree_cp nr, xinfo& xi, dinfo& di, double* phi, sinfo& sl, sinfo& sr);
+//--------------------------------------------------
+//raise the gaussian likelihood behind s to the power b (tempered chains).
+//n0 keeps the raw count used by the minimum leaf size rules.
+inline void temper(sinfo& s, double b) { s.n *= b; s.sy *= b; s.sy2 *= b; }
 
 //--------------------------------------------------
 //log of the integreted likelihood
@@ -108,11 +140,11 @@ void fit(tree& t, xinfo& xi, dinfo& di, double* fv);
 template<class T>
 double fit_i(T i, tree& t, xinfo& xi, dinfo& di)
 {
-  double *xx;
+  xrow xx;
   double fv = 0.0;
   tree::tree_cp bn;
 	//for(size_t i=0;i<di.n;i++) {
-		xx = di.x + i*di.p;
+		xx = di.row(i);
 		bn = t.bn(xx,xi);
 		fv = bn->getm();
 	//}
@@ -124,10 +156,10 @@ double fit_i(T i, tree& t, xinfo& xi, dinfo& di)
 template<class T>
 double fit_i(T i, tree& t, xinfo& xi, dinfo& di)
 {
-  double *xx;
+  xrow xx;
   double fv = 0.0;
   tree::tree_cp bn;
-  xx = di.x + i*di.p;
+  xx = di.row(i);
   //for (size_t j=0; j<t.size(); ++j) {
   bn = t.bn(xx,xi);
 	fv = bn->getm();
@@ -137,10 +169,10 @@ double fit_i(T i, tree& t, xinfo& xi, dinfo& di)
 template<class T>
 double fit_i(T i, std::vector<tree>& t, xinfo& xi, dinfo& di)
 {
-  double *xx;
+  xrow xx;
   double fv = 0.0;
   tree::tree_cp bn;
-  xx = di.x + i*di.p;
+  xx = di.row(i);
   for (size_t j=0; j<t.size(); ++j) {
 		bn = t[j].bn(xx,xi);
 		fv += bn->getm();
@@ -150,10 +182,10 @@ double fit_i(T i, std::vector<tree>& t, xinfo& xi, dinfo& di)
 template<class T>
 double fit_i_mult(T i, std::vector<tree>& t, xinfo& xi, dinfo& di)
 {
-  double *xx;
+  xrow xx;
   double fv = 1.0;
   tree::tree_cp bn;
-  xx = di.x + i*di.p;
+  xx = di.row(i);
   for (size_t j=0; j<t.size(); ++j) {
   	bn = t[j].bn(xx,xi);
 		fv *= bn->getm();
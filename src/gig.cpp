@@ -0,0 +1,183 @@
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+#include "gig.h"
+#include "GIGrvg.h"
+
+//chi or psi below this is taken as 0, as in GIGrvg
+static const double gig_ztol = DBL_EPSILON*10.0;
+
+//mode of the lambda >= 0, alpha = 1 density, or of f(1/x) for lambda < 1
+static double gig_mode(double lambda, double omega)
+{
+   if(lambda >= 1.)
+      return (std::sqrt((lambda - 1.)*(lambda - 1.) + omega*omega) + (lambda - 1.))/omega;
+   return omega/(std::sqrt((1. - lambda)*(1. - lambda) + omega*omega) + (1. - lambda));
+}
+
+//--------------------------------------------------
+bool gig_sampler::setup(double lambda_, double chi, double psi)
+{
+   kind = INVALID;
+   if(!(std::isfinite(lambda_) && std::isfinite(chi) && std::isfinite(psi)) ||
+      chi < 0. || psi < 0. || (chi == 0. && lambda_ <= 0.) || (psi == 0. && lambda_ >= 0.))
+      return false;
+
+   lambda = std::fabs(lambda_);
+   invert = lambda_ < 0.;
+   if(chi < gig_ztol) {
+      //gamma (lambda > 0) or inverse gamma
+      kind = lambda_ > 0. ? GAMMA : INV_GAMMA;
+      alpha = 2.0/psi;
+      return true;
+   }
+   if(psi < gig_ztol) {
+      //lambda < 0 here (bar psi tiny but positive): inverse gamma
+      kind = INV_GAMMA;
+      alpha = 2.0/chi;
+      return true;
+   }
+
+   alpha = std::sqrt(chi/psi);
+   omega = std::sqrt(psi*chi);
+
+   if(lambda > 2. || omega > 3.) {
+      //ratio of uniforms with shift by the mode (Dagpunar 1989, Lehner 1989)
+      kind = ROU_SHIFT;
+      t = 0.5*(lambda - 1.);
+      s = 0.25*omega;
+      xm = gig_mode(lambda, omega);
+      nc = t*std::log(xm) - s*(xm + 1./xm);
+      //roots of the cubic y^3 + a y^2 + b y + c bound the rectangle
+      double ca = -(2.*(lambda + 1.)/omega + xm), cb = 2.*(lambda - 1.)*xm/omega - 1., cc = xm;
+      double p = cb - ca*ca/3., q = 2.*ca*ca*ca/27. - ca*cb/3. + cc;
+      double fi = std::acos(-q/(2.*std::sqrt(-(p*p*p)/27.))), fak = 2.*std::sqrt(-p/3.);
+      double y1 = fak*std::cos(fi/3.) - ca/3.;
+      double y2 = fak*std::cos(fi/3. + 4./3.*M_PI) - ca/3.;
+      umax = (y1 - xm)*std::exp(t*std::log(y1) - s*(y1 + 1./y1) - nc);
+      umin = (y2 - xm)*std::exp(t*std::log(y2) - s*(y2 + 1./y2) - nc);
+   } else if(lambda >= 1. - 2.25*omega*omega || omega > 0.2) {
+      //ratio of uniforms without shift (Dagpunar 1988, Lehner 1989)
+      kind = ROU_NOSHIFT;
+      t = 0.5*(lambda - 1.);
+      s = 0.25*omega;
+      xm = gig_mode(lambda, omega);
+      nc = t*std::log(xm) - s*(xm + 1./xm);
+      double ym = ((lambda + 1.) + std::sqrt((lambda + 1.)*(lambda + 1.) + omega*omega))/omega;
+      umin = 0.;
+      umax = std::exp(0.5*(lambda + 1.)*std::log(ym) - s*(ym + 1./ym) - nc);
+   } else {
+      //constant hat in the log-concave part, 0 <= lambda < 1, omega <= 0.2
+      kind = NEW_APPROACH;
+      xm = gig_mode(lambda, omega);
+      x0 = omega/(1. - lambda);
+      k0 = std::exp((lambda - 1.)*std::log(xm) - 0.5*omega*(xm + 1./xm));
+      A[0] = k0*x0;
+      if(x0 >= 2./omega) {
+         k1 = 0.;
+         A[1] = 0.;
+         k2 = std::pow(x0, lambda - 1.);
+         A[2] = k2*2.*std::exp(-omega*x0/2.)/omega;
+      } else {
+         k1 = std::exp(-omega);
+         A[1] = lambda == 0. ? k1*std::log(2./(omega*omega))
+                             : k1/lambda*(std::pow(2./omega, lambda) - std::pow(x0, lambda));
+         k2 = std::pow(2./omega, lambda - 1.);
+         A[2] = k2*2.*std::exp(-1.)/omega;
+      }
+      Atot = A[0] + A[1] + A[2];
+      a = x0 > 2./omega ? x0 : 2./omega;
+   }
+   return true;
+}
+
+double gig_sampler::draw(RNG& gen) const
+{
+   double X;
+   switch(kind) {
+   case GAMMA:
+      return gen.gamma(lambda, alpha);
+   case INV_GAMMA:
+      return 1.0/gen.gamma(lambda, alpha);
+   case ROU_SHIFT:
+      for(;;) {
+         double U = umin + gen.uniform()*(umax - umin), V = gen.uniform();
+         X = U/V + xm;
+         if(X > 0. && std::log(V) <= t*std::log(X) - s*(X + 1./X) - nc) break;
+      }
+      break;
+   case ROU_NOSHIFT:
+      for(;;) {
+         double U = umax*gen.uniform(), V = gen.uniform();
+         X = U/V;
+         if(std::log(V) <= t*std::log(X) - s*(X + 1./X) - nc) break;
+      }
+      break;
+   case NEW_APPROACH:
+      for(;;) {
+         double V = Atot*gen.uniform(), hx;
+         if(V <= A[0]) {
+            X = x0*V/A[0];
+            hx = k0;
+         } else if((V -= A[0]) <= A[1]) {
+            if(lambda == 0.) {
+               X = omega*std::exp(std::exp(omega)*V);
+               hx = k1/X;
+            } else {
+               X = std::pow(std::pow(x0, lambda) + lambda/k1*V, 1./lambda);
+               hx = k1*std::pow(X, lambda - 1.);
+            }
+         } else {
+            V -= A[1];
+            X = -2./omega*std::log(std::exp(-omega/2.*a) - omega/(2.*k2)*V);
+            hx = k2*std::exp(-omega/2.*X);
+         }
+         double U = gen.uniform()*hx;
+         if(std::log(U) <= (lambda - 1.)*std::log(X) - omega/2.*(X + 1./X)) break;
+      }
+      break;
+   default:
+      return std::numeric_limits<double>::quiet_NaN();
+   }
+   return invert ? alpha/X : alpha*X;
+}
+
+//--------------------------------------------------
+void gig_draws(size_t n, const double* lambda, const double* chi, const double* psi,
+               RNG& gen, double* res)
+{
+   gig_sampler g;
+   for(size_t i=0;i<n;i++) {
+      g.setup(lambda[i], chi[i], psi[i]);
+      res[i] = g.draw(gen);
+   }
+}
+
+//--------------------------------------------------
+//GIGrvg's entry points (GIGrvg.h), on R's generator
+static gig_sampler r_gig_sampler(double lambda, double chi, double psi)
+{
+   gig_sampler g;
+   if(!g.setup(lambda, chi, psi))
+      Rcpp::stop("invalid parameters for GIG distribution: lambda=%g, chi=%g, psi=%g",
+                 lambda, chi, psi);
+   return g;
+}
+
+SEXP do_rgig(int n, double lambda, double chi, double psi)
+{
+   if(n <= 0) Rcpp::stop("sample size 'n' must be positive integer.");
+   gig_sampler g = r_gig_sampler(lambda, chi, psi);
+   RNG gen;
+   Rcpp::NumericVector res(n);
+   for(int i=0;i<n;i++) res[i] = g.draw(gen);
+   return res;
+}
+
+//[[Rcpp::export]]
+double do_rgig1(double lambda, double chi, double psi)
+{
+   RNG gen;
+   return r_gig_sampler(lambda, chi, psi).draw(gen);
+}
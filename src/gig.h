@@ -0,0 +1,44 @@
+#ifndef GUARD_gig_h
+#define GUARD_gig_h
+
+#include <cstddef>
+
+#include "rng.h"
+
+/*
+Generalized inverse Gaussian draws, density proportional to
+x^(lambda - 1) exp(-(chi/x + psi x)/2), by the generators of GIGrvg
+(Hoermann and Leydold, 2014) without any of the R API: nothing is
+allocated, parameters are checked once, and the setup of the
+ratio-of-uniforms or rejection hat is done once per parameter set and can be
+reused for any number of draws. Uniform and gamma variates come from an
+RNG, so this is as thread safe as the RNG it is given.
+*/
+class gig_sampler {
+public:
+   gig_sampler() : kind(INVALID) {}
+   gig_sampler(double lambda, double chi, double psi) { setup(lambda, chi, psi); }
+
+   //false (and draw() gives NaN) for parameters outside the GIG family
+   bool setup(double lambda, double chi, double psi);
+   double draw(RNG& gen) const;
+
+private:
+   enum method { INVALID, GAMMA, INV_GAMMA, ROU_NOSHIFT, NEW_APPROACH, ROU_SHIFT };
+   method kind;
+   bool invert;    //lambda < 0, draws of the lambda > 0 case are inverted
+   double lambda;  //|lambda|
+   double alpha;   //sqrt(chi/psi), or the gamma scale
+   double omega;   //sqrt(chi psi)
+   //ratio of uniforms: log f = t log x - s (x + 1/x) - nc, mode xm,
+   //u in (umin, umax)
+   double t, s, nc, xm, umin, umax;
+   //new approach: hat areas A, heights k, split x0, start of the tail a
+   double A[3], Atot, k0, k1, k2, x0, a;
+};
+
+//one draw for each parameter set, in order
+void gig_draws(size_t n, const double* lambda, const double* chi, const double* psi,
+               RNG& gen, double* res);
+
+#endif
@@ -2,14 +2,35 @@
 #define GUARD_info_h
 #include <cmath>
 
+//how the variance is modelled: constant (DR-BART-L), by a forest in x
+//(DR-BART-LH) or by a forest in u and x (DR-BART)
+enum variance_mode { VAR_CONST, VAR_X, VAR_UX };
+
+//one observation's x, either a row of a row-major block or the ith
+//entry of each column
+class xrow {
+public:
+   xrow() : r(0), cols(0), i(0) {}
+   xrow(const double *r_) : r(r_), cols(0), i(0) {}
+   xrow(double * const *cols_, size_t i_) : r(0), cols(cols_), i(i_) {}
+   double operator[](size_t j) const {return r ? r[j] : cols[j][i];}
+private:
+   const double *r;
+   double * const *cols;
+   size_t i;
+};
+
 //data
 class dinfo {
 public:
-   dinfo() {p=0;n=0;x=0;y=0;}
+   dinfo() {p=0;n=0;x=0;cols=0;y=0;}
    size_t p;  //number of vars
    size_t n;  //number of observations
    double *x; // jth var of ith obs is *(x + p*i+j)
+   double * const *cols; // if set, jth var of ith obs is cols[j][i] and x is unused
    double *y; // ith y is *(y+i) or y[i]
+   double& at(size_t i, size_t j) const {return cols ? cols[j][i] : x[p*i + j];}
+   xrow row(size_t i) const {return cols ? xrow(cols, i) : xrow(x + p*i);}
 };
 
 //prior and mcmc
@@ -28,6 +49,9 @@ struct pinfo
    //sigma
    double sigma = 1.0;
    
+   //power on the likelihood, < 1 for the heated chains in parallel tempering
+   double temper = 1.0;
+   
    pinfo() = default; 
    
    pinfo(double pbd, double pb, 
@@ -0,0 +1,27 @@
+#ifndef GUARD_isa_h
+#define GUARD_isa_h
+
+/*
+The package is built for the baseline instruction set, so one build runs on
+any x86-64 machine. The kernels that every sweep runs per observation or per
+mixture component (routing x down a tree, the sufficient statistics, fits,
+mixture densities, log-sum-exp) are marked DRBART_CLONES: gcc then compiles
+each of them once for baseline x86-64, once for AVX2 and once for AVX-512,
+and the dynamic loader picks the best one the CPU supports when the package
+is loaded (an ifunc), so there is no check per call.
+
+That needs gcc (clang's target_clones is not complete on the versions R
+ships with) and an ELF target with ifuncs. Elsewhere, or with
+-DDRBART_NO_CLONES, the marker is empty and only the baseline is built.
+It also rules out -flto: gcc's link time optimization loses the clones of a
+function defined in one file and called from another.
+*/
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__ELF__) && !defined(DRBART_NO_CLONES)
+#define DRBART_CLONES __attribute__((target_clones("default", "avx2", "avx512f")))
+#else
+#define DRBART_CLONES
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mixture.h"
+#include "isa.h"
+
+//--------------------------------------------------
+DRBART_CLONES
+double normal_mixture::cdf(double y) const
+{
+   double F = 0.0;
+   for(size_t h=0;h<w.size();h++) F += w[h]*Phi((y - mu[h])/sd[h]);
+   return F;
+}
+
+DRBART_CLONES
+double normal_mixture::pdf(double y) const
+{
+   double f = 0.0;
+   for(size_t h=0;h<w.size();h++) f += w[h]*phi((y - mu[h])/sd[h])/sd[h];
+   return f;
+}
+
+//--------------------------------------------------
+DRBART_CLONES
+double normal_mixture::logpdf(double y) const
+{
+   double lmax = -INFINITY;
+   std::vector<double> l(w.size());
+   for(size_t h=0;h<w.size();h++) {
+      double z = (y - mu[h])/sd[h];
+      l[h] = std::log(w[h]/sd[h]) - 0.5*z*z;
+      lmax = std::max(lmax, l[h]);
+   }
+   if(lmax == -INFINITY) return lmax;
+   double s = 0.0;
+   for(size_t h=0;h<w.size();h++) s += std::exp(l[h] - lmax);
+   return lmax + std::log(s) - 0.5*std::log(2*M_PI);
+}
+
+//--------------------------------------------------
+DRBART_CLONES
+void normal_mixture::add_cdf(double z0, double dz, size_t G, double* d) const
+{
+   if(!(dz > 0)) { d[0] += cdf(z0); return; }
+   double last = G + 1;
+   for(size_t h=0;h<w.size();h++) {
+      //nodes j0, ..., j1 - 1 are within 8 sd, nodes from j1 on above
+      double a = std::ceil((mu[h] - 8*sd[h] - z0)/dz), b = std::ceil((mu[h] + 8*sd[h] - z0)/dz);
+      size_t j0 = (size_t) std::min(last, std::max(0.0, a)),
+             j1 = (size_t) std::min(last, std::max((double) j0, b));
+      for(size_t j=j0;j<j1;j++) {
+         double v = w[h]*Phi((z0 + j*dz - mu[h])/sd[h]);
+         d[j] += v;
+         d[j+1] -= v;
+      }
+      if(j1 <= G) d[j1] += w[h];
+   }
+}
@@ -0,0 +1,68 @@
+#ifndef GUARD_mixture_h
+#define GUARD_mixture_h
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/*
+The conditional density of y given x under one posterior draw:
+sum_h w[h] N(mu[h], sd[h]^2), with a component per interval of the u
+partition. Nothing here calls into R, so it is safe on any thread.
+*/
+struct normal_mixture {
+   std::vector<double> w, mu, sd;
+
+   static double Phi(double z) { return 0.5*std::erfc(-z*M_SQRT1_2); }
+   static double phi(double z) { return std::exp(-0.5*z*z)/std::sqrt(2*M_PI); }
+
+   //cdf, pdf, logpdf and add_cdf are in mixture.cpp, built per instruction
+   //set (isa.h)
+   double cdf(double y) const;
+   double pdf(double y) const;
+   double mean() const {
+      double m = 0.0;
+      for(size_t h=0;h<w.size();h++) m += w[h]*mu[h];
+      return m;
+   }
+   double var() const {
+      double m = mean(), v = 0.0;
+      for(size_t h=0;h<w.size();h++) v += w[h]*(sd[h]*sd[h] + (mu[h] - m)*(mu[h] - m));
+      return v;
+   }
+
+   //log pdf, without underflow in the tails
+   double logpdf(double y) const;
+
+   //adds the cdf at z0 + j*dz, j = 0, ..., G, to nodes held as differences:
+   //node j is d[0] + ... + d[j], and d has G + 2 entries. a component only
+   //costs the nodes within 8 sd of its mean, past which its cdf is 0 or 1, a
+   //single step in d.
+   void add_cdf(double z0, double dz, size_t G, double* d) const;
+
+   //the q quantile, z = qnorm(q). the mixture quantile lies between the
+   //smallest and largest component quantiles, which bracket the root; Newton
+   //steps from the weighted mean of the component quantiles, falling back
+   //to bisection whenever a step leaves the bracket.
+   double quantile(double q, double z) const {
+      double lo = INFINITY, hi = -INFINITY, y = 0.0;
+      for(size_t h=0;h<w.size();h++) {
+         double qh = mu[h] + sd[h]*z;
+         lo = std::min(lo, qh);
+         hi = std::max(hi, qh);
+         y += w[h]*qh;
+      }
+      if(!(hi > lo)) return lo;
+      for(int it=0;it<100;it++) {
+         double F = cdf(y) - q;
+         if(F < 0) lo = y; else hi = y;
+         if(std::fabs(F) < 1e-12 || hi - lo < 1e-12*(1 + std::fabs(y))) break;
+         double f = pdf(y);
+         double ynew = f > 0 ? y - F/f : lo - 1; //outside: bisect
+         y = (ynew > lo && ynew < hi) ? ynew : 0.5*(lo + hi);
+      }
+      return y;
+   }
+};
+
+#endif
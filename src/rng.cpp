@@ -2,20 +2,20 @@
 #include "rng.h"
 
   //standard normal, truncated to be >lo
-  double rtnormlo0(double lo) {
+  double rtnormlo0(double lo, RNG& gen) {
     double x;
     if(lo<0) {
-      x = R::rnorm(0.0, 1.0);
-      while(x<lo) x = R::rnorm(0.0, 1.0);
+      x = gen.normal(0.0, 1.0);
+      while(x<lo) x = gen.normal(0.0, 1.0);
     } else {
       double a = 0.5*(lo + sqrt(lo*lo + 4.0));
-      x = R::rexp(1.0/a) + lo;
-      double u = R::runif(0.0, 1.0);
+      x = gen.exponential(1.0/a) + lo;
+      double u = gen.uniform(0.0, 1.0);
       double diff = (x-a);
       double r = exp(-0.5*diff*diff);
       while(u > r) {
-        x = R::rexp(1.0/a) + lo;
-        u = R::runif(0.0, 1.0);
+        x = gen.exponential(1.0/a) + lo;
+        u = gen.uniform(0.0, 1.0);
         diff = (x-a);
         r = exp(-0.5*diff*diff);
       }
@@ -23,6 +23,11 @@
     return x;
   }
 
+  double rtnormlo0(double lo) {
+    RNG gen;
+    return rtnormlo0(lo, gen);
+  }
+
   double rtnormlo1(double mean, double lo) {
     return mean + rtnormlo0(lo - mean);
   }
@@ -32,6 +37,11 @@
     return mean + rtnormlo0(lostar)*sd;
   }
 
+  double rtnormlo(double mean, double sd, double lo, RNG& gen) {
+    double lostar = (lo-mean)/sd;
+    return mean + rtnormlo0(lostar, gen)*sd;
+  }
+
 	// TO CHECK
   double rtnormhi1(double mean, double hi) {
     return -rtnormlo1(-mean, -hi);
@@ -1,22 +1,46 @@
 #ifndef RNG_H
 #define RNG_H
 #include <Rcpp.h>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <sstream>
+#include <string>
 
 using std::vector;
 
+// By default every draw goes through R's generator (and so respects
+// set.seed()), which must only be touched from the main thread. An RNG
+// constructed with a seed owns its own stream instead and can be handed to a
+// worker thread.
 class RNG
 {
  private:
+  bool own;            // true if draws come from eng rather than from R
+  std::mt19937_64 eng;
+  // uniform on the open interval (0, 1), like unif_rand()
+  double unif01() { return ((eng() >> 11) + 0.5) * (1.0 / 9007199254740992.0); }
  public:
+  RNG() : own(false) {}
+  explicit RNG(uint64_t seed) : own(true), eng(seed) {}
+  // false if draws come from R, i.e. we must be on the main thread
+  bool owned() const { return own; }
+  // state of the owned stream as text, for checkpoints (R's own state is
+  // saved through .Random.seed instead)
+  std::string state() const { std::ostringstream os; os << eng; return os.str(); }
+  void set_state(const std::string& s) { std::istringstream is(s); is >> eng; }
+
   // Continuous Distributions
   double uniform(double x = 0.0, double y = 1.0)
-    { return R::runif(x, y); }
+    { return own ? x + (y - x) * unif01() : R::runif(x, y); }
   double normal(double mu = 0.0, double sd = 1.0)
-    { return R::rnorm(mu, sd); }
+    { return own ? mu + sd * std::normal_distribution<double>()(eng) : R::rnorm(mu, sd); }
   double gamma(double shape = 1, double scale = 1)
-  { return R::rgamma(shape, 1)*scale; }
+  { return (own ? std::gamma_distribution<double>(shape, 1.0)(eng) : R::rgamma(shape, 1))*scale; }
+  double exponential(double scale = 1.0)
+    { return own ? -std::log(unif01())*scale : R::rexp(scale); }
   double chi_square(double df)
-    { return R::rchisq(df); }//return gamma(df / 2.0, 0.5); }
+    { return own ? std::chi_squared_distribution<double>(df)(eng) : R::rchisq(df); }//return gamma(df / 2.0, 0.5); }
   double beta(double a1, double a2)
     { const double x1 = gamma(a1, 1); return (x1 / (x1 + gamma(a2, 1))); }
 
@@ -43,6 +67,13 @@ class RNG
 }; // class RNG
 
 
+//64 bit seed for a standalone RNG, drawn from R's generator (main thread only)
+inline uint64_t draw_seed() {
+  uint64_t hi = (uint64_t) (R::runif(0.0, 1.0) * 4294967296.0);
+  uint64_t lo = (uint64_t) (R::runif(0.0, 1.0) * 4294967296.0);
+  return (hi << 32) | lo;
+}
+
 inline double znorm() { 
   return R::rnorm(0.0, 1.0); 
 }
@@ -100,6 +131,8 @@ double rtnormlo0(double lo);
 double rtnormlo1(double mean, double lo);
 double rtnormhi1(double mean, double lo);
 double rtnormlo(double mean, double sd, double lo);
+double rtnormlo0(double lo, RNG& gen);
+double rtnormlo(double mean, double sd, double lo, RNG& gen);
 double rtnormhi(double mean, double sd, double hi); 
   
 #endif // RNG_H
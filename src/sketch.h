@@ -0,0 +1,71 @@
+#ifndef GUARD_sketch_h
+#define GUARD_sketch_h
+
+#include <algorithm>
+#include <cstddef>
+
+/*
+The P^2 estimate of the p quantile of a stream (Jain and Chlamtac, 1985):
+five markers at the minimum, the p/2, p and (1+p)/2 quantiles and the
+maximum, whose heights are adjusted by piecewise parabolic interpolation as
+observations arrive. Constant memory whatever the length of the stream.
+
+The number of observations is not stored: a prediction keeps one sketch per
+(row, y, probability) and they all see the same number of draws, so the
+caller passes it in. The first five observations are kept as they are.
+*/
+struct p2_quantile {
+   double q[5]; //marker heights
+   int n[5];    //marker positions, 0 based
+
+   //add x, the count-th observation (0 based)
+   void add(double x, size_t count, double p) {
+      if(count < 5) {
+         q[count] = x;
+         if(count == 4) {
+            std::sort(q, q + 5);
+            for(int i=0;i<5;i++) n[i] = i;
+         }
+         return;
+      }
+      int k;
+      if(x < q[0]) { q[0] = x; k = 0; }
+      else if(x >= q[4]) { q[4] = x; k = 3; }
+      else { k = 0; while(x >= q[k + 1]) k++; }
+      for(int i=k+1;i<5;i++) n[i]++;
+
+      //desired positions after count + 1 observations
+      double c = (double) count, d[5] = {0.0, c*p/2, c*p, c*(1 + p)/2, c};
+      for(int i=1;i<4;i++) {
+         double e = d[i] - n[i];
+         if((e >= 1 && n[i + 1] - n[i] > 1) || (e <= -1 && n[i - 1] - n[i] < -1)) {
+            int s = e > 0 ? 1 : -1;
+            double qp = parabolic(i, s);
+            if(!(q[i - 1] < qp && qp < q[i + 1])) qp = q[i] + s*(q[i + s] - q[i])/(n[i + s] - n[i]);
+            q[i] = qp;
+            n[i] += s;
+         }
+      }
+   }
+
+   //the estimate after count observations
+   double value(size_t count, double p) const {
+      if(count >= 5) return q[2];
+      if(count == 0) return 0.0;
+      double v[5];
+      std::copy(q, q + count, v);
+      std::sort(v, v + count);
+      double h = (count - 1)*p;
+      size_t lo = (size_t) h;
+      return lo + 1 < count ? v[lo] + (h - lo)*(v[lo + 1] - v[lo]) : v[lo];
+   }
+
+private:
+   double parabolic(int i, int s) const {
+      double a = (double) s/(n[i + 1] - n[i - 1]);
+      return q[i] + a*((n[i] - n[i - 1] + s)*(q[i + 1] - q[i])/(n[i + 1] - n[i]) +
+                       (n[i + 1] - n[i] - s)*(q[i] - q[i - 1])/(n[i] - n[i - 1]));
+   }
+};
+
+#endif
@@ -16,63 +16,103 @@ class ld_norm: public logdensity {
   ld_norm(double mu_, double sigma_) { mu=mu_; sigma=sigma_; }
 };
 
-// not even sure what the point of this being a class is... 
-// like yes the inheritance hierarchy is nice but we really don't use it 
-// and we only end up making one copy of this so it seems like it would 
-// be more natural for it to be a function. for now keeping it a class for 
-// practice's sake. 
-class ld_bartU: public logdensity {
+//log density of the u of observation i given everything else, up to a
+//constant, for the sampler of the given variance model. only the trees that
+//split on u move with it: the mean trees, and with VAR_UX the precision trees
+template<variance_mode V>
+class ld_bartU {
   public:
   double f; //fit that doesn't depend on u
-  double sigma;
-  bool scalemix;
+  double sigma; //sd that doesn't depend on u
   
   size_t i; //observation index
-  std::vector<tree> using_u; //set of trees that split on u
-  xinfo xi;
-  dinfo di; //pointers to xi, di
+  std::vector<tree>* using_u; //set of trees that split on u
+  xinfo* xi;
+  dinfo* di;
   
-  std::vector<tree> using_uprec; //set of trees that split on u
-  xinfo xiprec;
-  dinfo diprec; //pointers to xi, di
+  std::vector<tree>* using_uprec; //set of trees that split on u, VAR_UX only
+  xinfo* xiprec;
+  dinfo* diprec;
   
   double yobs;
-  int j, p;
+  double temper; //power on the likelihood, 1 except in heated chains
   
   double val(double y) {
-  //   // temporary method to agree with virtual method in base class...? 
-  //   return(0); 
-  // }
-  // 
-  // double val(double y, dinfo& di, dinfo& diprec, 
-  //            std::vector<tree>& using_u, std::vector<tree>& using_uprec) { 
-    double oldx = *(di.x + i*di.p);
-    *(di.x + i*di.p) = y;
-    if(scalemix) *(diprec.x + i*diprec.p) = y;
-    double mm = f + fit_i(i, using_u, xi, di);
+    //with VAR_UX diprec reads the same u column, so this moves both
+    double& xu = di->at(i, 0);
+    double oldx = xu;
+    xu = y;
+    double mm = f + fit_i(i, *using_u, *xi, *di);
     double pp = sigma;
-    if(scalemix) {
-      pp /= sqrt(fit_i_mult(i, using_uprec, xiprec, diprec));
+    if(V == VAR_UX) {
+      pp /= sqrt(fit_i_mult(i, *using_uprec, *xiprec, *diprec));
     }
-    *(di.x + i*di.p) = oldx;
-    if(scalemix) *(diprec.x + i*diprec.p) = oldx;
-    return(R::dnorm(yobs, mm, pp, 1)); 
+    xu = oldx;
+    return(temper*R::dnorm(yobs, mm, pp, 1)); 
   }
   
-  ld_bartU(double f_, double sigma_) { f=f_; sigma=sigma_; scalemix=false;}  
-  // ld_bartU(double f, double sigma, bool scalemix) {
-  //   this->f = f; 
-  //   this->sigma = sigma;
-  //   this->scalemix = scalemix;
-  // }
-  // 
-  // // ld_bartU(double f_, double sigma_, dinfo& di, dinfo& diprec) {
-  // //   f = f_; 
-  // //   sigma = sigma_;
-  // //   scalemix = false;
-  // // }
+  ld_bartU() : f(0.0), sigma(1.0), i(0), using_u(0), xi(0), di(0),
+               using_uprec(0), xiprec(0), diprec(0), yobs(0.0), temper(1.0) {}
 };
 
+//one slice sampling update (stepping out, then shrinkage) of x0 under the log
+//density g.val, drawing from gen. g is any type with a val(double), so the
+//density inlines into the loop. interrupts are only checked when gen is R's
+//generator, since R_CheckUserInterrupt may not be called off the main thread
+template<class LD>
+double slice(double x0, LD& g, RNG& gen, double w=1., double m=INFINITY, 
+             double lower=-INFINITY, double upper=INFINITY) {
+  constexpr double EPS = 1e-12;
+  double x1; // new sample 
+  
+  double gx0 = g.val(x0); // current loglik
+  double logy = gx0 - gen.exponential(1.);
+  double u = gen.uniform(0., w); 
+  double L = x0 - u;
+  double R = x0 + (w - u);
+	// MAYBE CAN AUTOMATICALLY GET A LARGE ENOUGH INTERVAL 
+	// DIRECTLY FROM THE CUTPOINTS 
+  while(true) {
+    if(!gen.owned()) R_CheckUserInterrupt();
+    if(L<=lower) { break; }
+    if(g.val(L) <= logy) { break; }
+    L -= w;
+  }
+  while(true) {
+    if(!gen.owned()) R_CheckUserInterrupt();
+    if(R>=upper) { break; }
+    if(g.val(R) <= logy) { break; }
+    R += w;
+  }
+  if(L<lower) {L=lower;}
+  if(R>upper) {R=upper;}
+
+	// [L, R] is our interval to sample x1 uniformly from 
+  
+  while(true) {
+    if(!gen.owned()) R_CheckUserInterrupt();
+    x1 = gen.uniform(L, R);
+    double gx1 = g.val(x1);
+    if(gx1>=logy) { break; }
+    if(x1>x0) {
+      R = x1;
+    } else {
+      L = x1;
+    }
+    if(R-L < EPS) {
+      // if the interval is too small, just return x0
+      // this can happen if the log density is very flat
+      // or if the interval is too small to sample from
+      x1 = x0;
+      break;
+    }
+  }
+  
+  return(x1);
+}
+
 double slice(double x0, logdensity* g, double w=1., double m=INFINITY, 
              double lower=-INFINITY, double upper=INFINITY);
+double slice(double x0, logdensity* g, RNG& gen, double w=1., double m=INFINITY, 
+             double lower=-INFINITY, double upper=INFINITY);
 #endif
@@ -0,0 +1,83 @@
+#ifndef GUARD_splitcounts_h
+#define GUARD_splitcounts_h
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tree.h"
+
+/*
+The rules of the current trees of a chain, counted per tree slot and
+variable, and the u cutpoints in use with the number of rules on each. Trees
+are in slots, mean trees first, then the precision trees.
+
+The counts are built once from the trees (count, at the start, on a warm
+start or a resume) and then only follow the accepted births and deaths, which
+bd, bdhet and bdprec report with the rule's (v, c). So which trees split on
+u, and the partition of u for the u update, are read off without walking a
+tree. Slots are only touched by the thread updating their tree; the u cuts
+are shared by the whole chain and take a lock, once per accepted move.
+*/
+class SplitCounts {
+public:
+   SplitCounts() : mtx(new std::mutex) {}
+
+   //start over with no trees
+   void clear() { slots.clear(); refs.clear(); }
+   //count the rules of t into slots first, ..., first + t.size() - 1, which
+   //have to be empty (after clear())
+   void count(std::vector<tree>& t, size_t first = 0) {
+      if(slots.size() < first + t.size()) slots.resize(first + t.size());
+      tree::npv nds;
+      for(size_t j=0;j<t.size();j++) {
+         nds.clear();
+         t[j].getnodes(nds);
+         for(size_t k=0;k<nds.size();k++)
+            if(nds[k]->getl()) add(first + j, nds[k]->getv(), nds[k]->getc(), 1);
+      }
+   }
+
+   //an accepted birth or death of rule (v, c) in the tree of slot j
+   void birth(size_t j, size_t v, size_t c) { add(j, v, c, 1); }
+   void death(size_t j, size_t v, size_t c) { add(j, v, c, -1); }
+
+   //rules on variable v in the tree of slot j
+   size_t nuse(size_t j, size_t v) const {
+      return j < slots.size() && v < slots[j].size() ? slots[j][v] : 0;
+   }
+   //rules on each of the first p variables over slots first, ..., first + n - 1
+   void var_counts(int* out, size_t p, size_t first, size_t n) const {
+      for(size_t v=0;v<p;v++) out[v] = 0;
+      for(size_t j=first;j<first + n && j<slots.size();j++)
+         for(size_t v=0;v<p && v<slots[j].size();v++) out[v] += slots[j][v];
+   }
+   //the sorted distinct u cut indices in use, between 0 and last (included)
+   void cuts(std::vector<size_t>& out, size_t last) const {
+      out.clear();
+      out.push_back(0);
+      for(std::map<size_t, size_t>::const_iterator it=refs.begin();it!=refs.end();++it)
+         if(it->first != 0 && it->first != last) out.push_back(it->first);
+      out.push_back(last);
+   }
+   size_t ncuts() const { return refs.size(); }
+
+private:
+   std::vector<std::vector<size_t> > slots; //rules on each variable, per slot
+   std::map<size_t, size_t> refs;           //u cut index -> rules using it
+   std::unique_ptr<std::mutex> mtx;         //guards refs
+
+   void add(size_t j, size_t v, size_t c, int d) {
+      std::vector<size_t>& sc = slots[j];
+      if(sc.size() <= v) sc.resize(v+1, 0);
+      sc[v] += d;
+      if(v != 0) return;
+      std::lock_guard<std::mutex> lk(*mtx);
+      if(d > 0) refs[c]++;
+      else if(--refs[c] == 0) refs.erase(c);
+   }
+};
+
+#endif
@@ -0,0 +1,200 @@
+#include <Rcpp.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "threads.h"
+
+//the library is loaded, and so this initialized, on R's thread
+static const std::thread::id r_thread = std::this_thread::get_id();
+
+//the pool in scope, and for a worker its pool and slot
+static thread_local thread_pool* scope_pool = 0;
+static thread_local thread_pool* worker_pool = 0;
+static thread_local size_t worker_slot = 0;
+
+static uint64_t ns_since(std::chrono::steady_clock::time_point t0)
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - t0).count();
+}
+
+//--------------------------------------------------
+thread_pool::thread_pool(size_t nthreads)
+   : nworkers(nthreads > 1 ? nthreads - 1 : 0), queued(0), stopping(false)
+{
+   for(size_t w=0;w<=nworkers;w++) slots.emplace_back(new slot);
+   for(size_t w=0;w<nworkers;w++) threads.emplace_back([this, w]() { work(w); });
+}
+
+thread_pool::~thread_pool()
+{
+   {
+      std::lock_guard<std::mutex> lk(sleep_mtx);
+      stopping = true;
+   }
+   wake.notify_all();
+   for(size_t w=0;w<threads.size();w++) threads[w].join();
+}
+
+thread_pool* thread_pool::current()
+{
+   return scope_pool;
+}
+
+std::vector<thread_pool::worker_stats> thread_pool::stats() const
+{
+   std::vector<worker_stats> out(slots.size());
+   for(size_t w=0;w<slots.size();w++) {
+      out[w].busy = slots[w]->busy_ns*1e-9;
+      out[w].idle = slots[w]->idle_ns*1e-9;
+      out[w].tasks = slots[w]->tasks;
+      out[w].steals = slots[w]->steals;
+   }
+   return out;
+}
+
+//a worker's own slot, or the shared one of the threads outside the pool
+size_t thread_pool::self() const
+{
+   return worker_pool == this ? worker_slot : nworkers;
+}
+
+void thread_pool::submit(task t)
+{
+   slot& s = *slots[self()];
+   {
+      std::lock_guard<std::mutex> lk(s.mtx);
+      s.q.push_back(std::move(t));
+   }
+   queued++;
+   { std::lock_guard<std::mutex> lk(sleep_mtx); }
+   wake.notify_one();
+}
+
+bool thread_pool::run_one()
+{
+   size_t me = self();
+   task t;
+   bool stolen = false;
+   {
+      //newest of our own first, it is the most likely to be in cache
+      slot& s = *slots[me];
+      std::lock_guard<std::mutex> lk(s.mtx);
+      if(!s.q.empty()) {
+         t = std::move(s.q.back());
+         s.q.pop_back();
+      }
+   }
+   for(size_t k=1;!t && k<slots.size();k++) {
+      //then the oldest of someone else's
+      slot& s = *slots[(me + k) % slots.size()];
+      std::lock_guard<std::mutex> lk(s.mtx);
+      if(!s.q.empty()) {
+         t = std::move(s.q.front());
+         s.q.pop_front();
+         stolen = true;
+      }
+   }
+   if(!t) return false;
+   queued--;
+
+   slot& s = *slots[me];
+   std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+   t();
+   s.busy_ns += ns_since(t0);
+   s.tasks++;
+   if(stolen) s.steals++;
+   return true;
+}
+
+void thread_pool::work(size_t w)
+{
+   worker_pool = this;
+   worker_slot = w;
+   scope_pool = this; //so nested parallel sections use this pool too
+   for(;;) {
+      if(run_one()) continue;
+      std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+      std::unique_lock<std::mutex> lk(sleep_mtx);
+      wake.wait(lk, [this]() { return stopping || queued > 0; });
+      slots[w]->idle_ns += ns_since(t0);
+      if(stopping && queued == 0) return;
+   }
+}
+
+//--------------------------------------------------
+void thread_pool::task_group::wait_quietly()
+{
+   while(pending) {
+      if(pool.run_one()) continue;
+      std::unique_lock<std::mutex> lk(pool.sleep_mtx);
+      pool.wake.wait(lk, [this]() { return pending == 0 || pool.queued > 0; });
+   }
+}
+
+void thread_pool::task_group::wait()
+{
+   wait_quietly();
+   std::exception_ptr e;
+   {
+      std::lock_guard<std::mutex> lk(emtx);
+      std::swap(e, err);
+   }
+   if(e) std::rethrow_exception(e);
+}
+
+Rcpp::DataFrame thread_stats(const thread_pool& pool)
+{
+   std::vector<thread_pool::worker_stats> st = pool.stats();
+   size_t nw = st.size();
+   Rcpp::NumericVector busy(nw), idle(nw), tasks(nw), steals(nw);
+   for(size_t w=0;w<nw;w++) {
+      busy[w] = st[w].busy;
+      idle[w] = st[w].idle;
+      tasks[w] = st[w].tasks;
+      steals[w] = st[w].steals;
+   }
+   return Rcpp::DataFrame::create(Rcpp::_["busy"] = busy, Rcpp::_["idle"] = idle,
+                                  Rcpp::_["tasks"] = tasks, Rcpp::_["steals"] = steals);
+}
+
+//--------------------------------------------------
+pool_scope::pool_scope(thread_pool* pool) : prev(scope_pool)
+{
+   scope_pool = pool;
+}
+
+pool_scope::~pool_scope()
+{
+   scope_pool = prev;
+}
+
+//--------------------------------------------------
+static std::mutex msg_mtx;
+static std::vector<std::string> msgs;
+
+void thread_message(const std::string& msg)
+{
+   if(std::this_thread::get_id() == r_thread) {
+      flush_thread_messages();
+      Rcpp::Rcout << msg;
+      return;
+   }
+   std::lock_guard<std::mutex> lk(msg_mtx);
+   msgs.push_back(msg);
+}
+
+void flush_thread_messages()
+{
+   if(std::this_thread::get_id() != r_thread) return;
+   std::vector<std::string> out;
+   {
+      std::lock_guard<std::mutex> lk(msg_mtx);
+      out.swap(msgs);
+   }
+   for(size_t i=0;i<out.size();i++) Rcpp::Rcout << out[i];
+}
@@ -0,0 +1,185 @@
+#ifndef GUARD_threads_h
+#define GUARD_threads_h
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Rcpp.h>
+
+/*
+One pool of threads for everything that runs in parallel: the tempered
+chains, the blocks of trees in the backfits, and the prediction and scoring
+loops of TreeSamples. The sampler and each TreeSamples own a pool, sized by
+n_threads, and put it in scope (pool_scope) around their parallel work, so
+parallel_blocks and parallel_for anywhere below pick it up. With no pool in
+scope, or a pool of one thread, they run in order on the calling thread.
+
+Each worker has its own deque of tasks: it runs from the back of its own and
+steals from the front of the others' when that is empty. A thread waiting on
+a task group (the caller, or a worker that started nested work) runs queued
+tasks while it waits, so nested parallel sections don't tie up threads.
+
+Only the thread that started a parallel section may call into R (Rcout, R's
+RNG, Rcpp::stop): parallel_blocks runs f(0) there and the rest wherever, and
+a task may end up on any thread. Code that can run off that thread reports
+through thread_message, which is printed from R's thread once it is back.
+*/
+
+class thread_pool {
+public:
+   //nthreads - 1 workers; the thread waiting on a task group is the other
+   explicit thread_pool(size_t nthreads);
+   ~thread_pool();
+   thread_pool(const thread_pool&) = delete;
+   thread_pool& operator=(const thread_pool&) = delete;
+
+   size_t size() const { return nworkers + 1; }
+
+   //the pool in scope on this thread, 0 if none
+   static thread_pool* current();
+
+   //time each worker spent running tasks and waiting for them, the tasks it
+   //ran and how many of those it stole. the last entry is the threads
+   //outside the pool that helped while waiting (no idle time for those)
+   struct worker_stats { double busy, idle; uint64_t tasks, steals; };
+   std::vector<worker_stats> stats() const;
+
+   //tasks run from this, and wait() until all of them have
+   class task_group {
+   public:
+      explicit task_group(thread_pool& pool) : pool(pool), pending(0) {}
+      ~task_group() { wait_quietly(); }
+      template<class F> void run(F f);
+      //help with queued tasks until the group is done, then rethrow the first
+      //exception a task threw
+      void wait();
+   private:
+      void wait_quietly();
+      thread_pool& pool;
+      std::atomic<size_t> pending;
+      std::mutex emtx;
+      std::exception_ptr err;
+   };
+
+private:
+   typedef std::function<void()> task;
+   struct slot {
+      std::mutex mtx;
+      std::deque<task> q;
+      std::atomic<uint64_t> busy_ns{0}, idle_ns{0}, tasks{0}, steals{0};
+   };
+
+   void submit(task t);
+   bool run_one();     //run a queued task on this thread, false if there is none
+   void work(size_t w);
+   size_t self() const;
+
+   size_t nworkers;
+   std::vector<std::unique_ptr<slot> > slots; //one per worker, then the outside threads'
+   std::vector<std::thread> threads;
+   std::atomic<size_t> queued;
+   std::mutex sleep_mtx;
+   std::condition_variable wake;
+   bool stopping;
+};
+
+//pool.stats() as a data frame, one row per worker, for R
+Rcpp::DataFrame thread_stats(const thread_pool& pool);
+
+//makes pool current on this thread for its lifetime
+class pool_scope {
+public:
+   explicit pool_scope(thread_pool* pool);
+   ~pool_scope();
+   pool_scope(const pool_scope&) = delete;
+   pool_scope& operator=(const pool_scope&) = delete;
+private:
+   thread_pool* prev;
+};
+
+//--------------------------------------------------
+//a diagnostic from code that may be off R's thread. printed with Rcout
+//right away on R's thread, otherwise by the next flush_thread_messages there
+void thread_message(const std::string& msg);
+void flush_thread_messages();
+
+//--------------------------------------------------
+template<class F>
+void thread_pool::task_group::run(F f)
+{
+   pending++;
+   pool.submit([this, f]() {
+      try {
+         f();
+      } catch (...) {
+         std::lock_guard<std::mutex> lk(emtx);
+         if (!err) err = std::current_exception();
+      }
+      //the group may be gone as soon as pending is 0, so nothing of it after
+      thread_pool& p = pool;
+      if (--pending == 0) {
+         { std::lock_guard<std::mutex> lk(p.sleep_mtx); }
+         p.wake.notify_all();
+      }
+   });
+}
+
+//--------------------------------------------------
+//run f(b) for b = 0, ..., nb - 1 and wait for all of them. f(0) runs on the
+//calling thread, the others on the pool in scope. so only f(0) may call
+//into R when called from the main thread; the first exception thrown is
+//rethrown here, on the calling thread, f(0)'s first.
+template<class F>
+void parallel_blocks(size_t nb, F f)
+{
+  thread_pool* pool = thread_pool::current();
+  if (!pool || pool->size() == 1 || nb < 2) {
+    for (size_t b = 0; b < nb; ++b) f(b);
+    flush_thread_messages();
+    return;
+  }
+  std::exception_ptr err0;
+  {
+    thread_pool::task_group g(*pool);
+    for (size_t b = 1; b < nb; ++b) g.run([&f, b]() { f(b); });
+    try {
+      f(0);
+    } catch (...) {
+      err0 = std::current_exception();
+    }
+    try {
+      g.wait();
+    } catch (...) {
+      if (!err0) err0 = std::current_exception();
+    }
+  }
+  flush_thread_messages();
+  if (err0) std::rethrow_exception(err0);
+}
+
+//f(i) for i = 0, ..., n - 1 in chunks spread over the pool in scope. no R
+//calls in f, it may run anywhere.
+template<class F>
+void parallel_for(size_t n, F f)
+{
+  thread_pool* pool = thread_pool::current();
+  size_t nt = pool ? pool->size() : 1;
+  size_t grain = std::max<size_t>(1, n / (4 * nt));
+  size_t nchunk = (n + grain - 1) / grain;
+  parallel_blocks(nchunk, [&](size_t c) {
+    size_t i1 = std::min(n, (c + 1) * grain);
+    for (size_t i = c * grain; i < i1; ++i) f(i);
+  });
+}
+
+#endif
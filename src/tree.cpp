@@ -1,23 +1,181 @@
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <new>
+#include <cstdint>
 #include "tree.h"
+#include "isa.h"
 
 using std::string;
 using Rcpp::Rcout;
 using std::endl;
 
+//--------------------------------------------------
+//node pool. every node below the top one is made by birth, copy or reading a
+//tree, and goes away by death or tonull, millions of times in a run. instead
+//of the heap they use slabs of node sized blocks recycled through free lists.
+//each thread has its own list, so births and deaths on the worker threads
+//take no lock, and trades batches with a shared list: a thread with too
+//many free nodes hands some back, one that runs out takes a batch. a node
+//freed on another thread than the one that made it just joins that thread's
+//list. when the shared list has grown enough since it was last looked at,
+//the slabs all of whose nodes are on it go back to the heap, so dropping a
+//big set of trees (a TreeSamples, say) gives its memory back.
+namespace {
+
+union pool_node {
+   pool_node* next;
+   size_t nshared;  //in the first block of a slab: its nodes on the shared list
+   alignas(tree) char bytes[sizeof(tree)];
+};
+
+//slabs are aligned to their size, so the slab of a node is found by masking
+const size_t slab_bytes = 1 << 16;
+const size_t pool_slab = slab_bytes / sizeof(pool_node) - 1;  //nodes per slab
+const size_t pool_batch = 256;  //nodes moved to or from the shared list at once
+
+pool_node* slab_of(pool_node* nd) {
+   return reinterpret_cast<pool_node*>(reinterpret_cast<std::uintptr_t>(nd) & ~(std::uintptr_t)(slab_bytes - 1));
+}
+
+struct shared_pool {
+   std::mutex mtx;
+   pool_node* head = 0;
+   size_t nfree = 0;
+   size_t swept = 0;  //nfree after the last sweep
+
+   //take n nodes, as a list
+   pool_node* take(size_t n) {
+      std::lock_guard<std::mutex> lk(mtx);
+      while(nfree < n) {
+         pool_node* slab = static_cast<pool_node*>(::operator new(slab_bytes, std::align_val_t(slab_bytes)));
+         for(size_t i=1;i<=pool_slab;i++) {
+            slab[i].next = head;
+            head = &slab[i];
+         }
+         nfree += pool_slab;
+      }
+      pool_node* first = head;
+      pool_node* last = head;
+      for(size_t i=1;i<n;i++) last = last->next;
+      head = last->next;
+      last->next = 0;
+      nfree -= n;
+      if(swept > nfree) swept = nfree;
+      return first;
+   }
+   void give(pool_node* first, pool_node* last, size_t n) {
+      std::lock_guard<std::mutex> lk(mtx);
+      last->next = head;
+      head = first;
+      nfree += n;
+      if(nfree >= std::max(2*swept, 4*pool_slab)) sweep();
+   }
+   //free the slabs whose nodes are all on the list. O(nfree), and nfree
+   //has at least doubled since the last one, so O(1) a node given back
+   void sweep() {
+      pool_node* nd;
+      for(nd=head;nd;nd=nd->next) slab_of(nd)->nshared = 0;
+      for(nd=head;nd;nd=nd->next) slab_of(nd)->nshared++;
+      std::vector<pool_node*> empty;
+      pool_node** link = &head;
+      while(*link) {
+         pool_node* sl = slab_of(*link);
+         if(sl->nshared == pool_slab) {
+            if(*link == sl + 1) empty.push_back(sl);  //count each slab once
+            *link = (*link)->next;
+            nfree--;
+         } else {
+            link = &(*link)->next;
+         }
+      }
+      for(size_t i=0;i<empty.size();i++) ::operator delete(empty[i], std::align_val_t(slab_bytes));
+      swept = nfree;
+   }
+};
+
+//never destroyed, so threads can still give back while the process exits
+shared_pool& shared() {
+   static shared_pool* sp = new shared_pool;
+   return *sp;
+}
+
+//the free nodes of one thread
+struct node_cache {
+   pool_node* head = 0;
+   size_t nfree = 0;
+
+   ~node_cache() { if(nfree) give(nfree); }
+
+   void refill(size_t n) {
+      pool_node* first = shared().take(n);
+      pool_node* last = first;
+      while(last->next) last = last->next;
+      last->next = head;
+      head = first;
+      nfree += n;
+   }
+   //hand the first n free nodes back
+   void give(size_t n) {
+      pool_node* first = head;
+      pool_node* last = head;
+      for(size_t i=1;i<n;i++) last = last->next;
+      head = last->next;
+      nfree -= n;
+      shared().give(first, last, n);
+   }
+};
+
+thread_local node_cache local_cache;
+
+}
+
+void* tree::operator new(std::size_t sz)
+{
+   if(sz != sizeof(tree)) return ::operator new(sz);
+   node_cache& tp = local_cache;
+   if(!tp.head) tp.refill(pool_batch);
+   pool_node* nd = tp.head;
+   tp.head = nd->next;
+   tp.nfree--;
+   return nd;
+}
+
+void tree::operator delete(void* p, std::size_t sz)
+{
+   if(!p) return;
+   if(sz != sizeof(tree)) {
+      ::operator delete(p);
+      return;
+   }
+   node_cache& tp = local_cache;
+   pool_node* nd = static_cast<pool_node*>(p);
+   nd->next = tp.head;
+   tp.head = nd;
+   if(++tp.nfree > 4*pool_batch) tp.give(2*pool_batch);
+}
+
+//one trip to the shared list for a whole tree instead of one per batch
+void tree::reserve(std::size_t n)
+{
+   node_cache& tp = local_cache;
+   if(tp.nfree < n) tp.refill(std::max(n - tp.nfree, pool_batch));
+}
+
 //--------------------------------------------------
 // constructors
 tree::tree(): mu(0.0),v(0),c(0),p(0),l(0),r(0) {}
 tree::tree(double m): mu(m),v(0),c(0),p(0),l(0),r(0) {}
-tree::tree(const tree& n): mu(0.0),v(0),c(0),p(0),l(0),r(0) { cp(this,&n); }
+tree::tree(const tree& n): mu(0.0),v(0),c(0),p(0),l(0),r(0) { reserve(n.treesize()); cp(this,&n); }
 //--------------------------------------------------
 //operators
 tree& tree::operator=(const tree& rhs)
 {
    if(&rhs != this) {
       tonull(); //kill left hand side (this)
+      reserve(rhs.treesize());
       cp(this,&rhs); //copy right hand side to left hand side
    }
    return *this;
@@ -26,7 +184,8 @@ tree& tree::operator=(const tree& rhs)
 //public functions
 // find bottom node pointer given x
 //--------------------
-tree::tree_cp tree::bn(double *x,xinfo& xi)
+DRBART_CLONES
+tree::tree_cp tree::bn(const xrow& x,xinfo& xi)
 {
    if(l==0) return this; //bottom node
    if(x[v] < xi[v][c]) {
@@ -322,22 +481,46 @@ void tree::cp(tree_p n, tree_cp o)
 //cut back to one node
 void tree::tonull()
 {
-   size_t ts = treesize();
-   while(ts>1) { //if false ts=1
-      npv nv;
-      getnogs(nv);
-      for(size_t i=0;i<nv.size();i++) {
-         delete nv[i]->l;
-         delete nv[i]->r;
-         nv[i]->l=0;
-         nv[i]->r=0;
-      }
-      ts = treesize(); 
+   if(l) { //a child's destructor takes its own children with it
+      delete l;
+      delete r;
    }
    mu=0.0;
    v=0;c=0;
    p=0;l=0;r=0;
 }
+//--------------------
+//build the tree from node info in the order getnodes gives (top node first,
+//every parent before its children)
+void tree::fromnodes(const std::vector<node_info>& nv)
+{
+   size_t tid,pid; //tid: id of current node, pid: parent's id
+   std::map<size_t,tree::tree_p> pts;  //pointers to nodes indexed by node id
+
+   tonull(); // obliterate old tree (if there)
+   reserve(nv.size());
+
+   //first node has to be the top one
+   pts[1] = this; //careful! this is not the first pts, it is pointer of id 1.
+   v = nv[0].v; c = nv[0].c; mu = nv[0].m;
+   p=0;
+
+   //now loop through the rest of the nodes knowing parent is already there.
+   for(size_t i=1;i!=nv.size();i++) {
+      tree::tree_p np = new tree;
+      np->v = nv[i].v; np->c=nv[i].c; np->mu=nv[i].m;
+      tid = nv[i].id;
+      pts[tid] = np;
+      pid = tid/2;
+      // set pointers
+      if(tid % 2 == 0) { //left child has even id
+         pts[pid]->l = np;
+      } else {
+         pts[pid]->r = np;
+      }
+      np->p = pts[pid];
+   }
+}
 //--------------------------------------------------
 //functions
 //--------------------
@@ -359,8 +542,6 @@ std::ostream& operator<<(std::ostream& os, const tree& t)
 //input operator
 std::istream& operator>>(std::istream& is, tree& t)
 {
-   size_t tid,pid; //tid: id of current node, pid: parent's id
-   std::map<size_t,tree::tree_p> pts;  //pointers to nodes indexed by node id
    size_t nn; //number of nodes
 
    t.tonull(); // obliterate old tree (if there)
@@ -382,26 +563,7 @@ std::istream& operator>>(std::istream& is, tree& t)
       }
    }
 
-   //first node has to be the top one
-   pts[1] = &t; //careful! this is not the first pts, it is pointer of id 1.
-   t.setv(nv[0].v); t.setc(nv[0].c); t.setm(nv[0].m);
-   t.p=0;
-
-   //now loop through the rest of the nodes knowing parent is already there.
-   for(size_t i=1;i!=nv.size();i++) {
-      tree::tree_p np = new tree;
-      np->v = nv[i].v; np->c=nv[i].c; np->mu=nv[i].m;
-      tid = nv[i].id;
-      pts[tid] = np;
-      pid = tid/2;
-      // set pointers
-      if(tid % 2 == 0) { //left child has even id
-         pts[pid]->l = np;
-      } else {
-         pts[pid]->r = np;
-      }
-      np->p = pts[pid];
-   }
+   t.fromnodes(nv);
    return is;
 }
 std::ostream& operator<<(std::ostream& os, const xinfo& xi)
@@ -42,6 +42,8 @@ struct node_info {
 typedef std::vector<double> vec_d; //double vector
 typedef std::vector<vec_d> xinfo; //vector of vectors, will be split rules
 
+class SplitCounts; //see splitcounts.h
+
 class tree {
 public:
    //------------------------------
@@ -50,10 +52,10 @@ public:
 #ifdef MPIBART
    friend bool bd(tree& x, xinfo& xi, pinfo& pi, RNG& gen, size_t numslaves);
 #else
-   friend bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen);
+   friend bool bd(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen, SplitCounts* sc, size_t slot);
    friend bool bd_rj(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen);
-   friend std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen);
-   friend std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen);
+   friend std::tuple<bool, bool> bdprec(tree& x, xinfo& xi, dinfo& di, pinfo& pi, RNG& gen, SplitCounts* sc, size_t slot);
+   friend std::tuple<bool, bool> bdhet(tree& x, xinfo& xi, dinfo& di, double* phi, pinfo& pi, RNG& gen, SplitCounts* sc, size_t slot);
 #endif
 
    //------------------------------
@@ -70,6 +72,12 @@ public:
    tree(double);
    ~tree() {tonull();}
 
+   //------------------------------
+   //nodes made with new come from a pool, see tree.cpp
+   static void* operator new(std::size_t sz);
+   static void operator delete(void* p, std::size_t sz);
+   static void reserve(std::size_t n); //have n nodes ready for this thread
+
    //------------------------------
    //operators
    tree& operator=(const tree&);
@@ -105,7 +113,7 @@ public:
    void getnodes(npv& v);         //get vector of all nodes
    void getnodes(cnpv& v) const;  //get all nodes
    //find node from x and region for var----------
-   tree_cp bn(double *x,xinfo& xi);  //find bottom node for x
+   tree_cp bn(const xrow& x,xinfo& xi);  //find bottom node for x
    void rg(size_t v, int* L, int* U) const; //find region [L,U] for var v.
    size_t nuse(size_t v); //how many times var v is used in a rule.
    void varsplits(std::set<size_t> &splits, size_t v); //splitting values for var v.
@@ -117,6 +125,7 @@ public:
    tree_p getptr(size_t nid); //get node pointer from node id, 0 if not there.
    bool isnog() const;
    void tonull(); //like a "clear", null tree has just one node
+   void fromnodes(const std::vector<node_info>& nv); //build from node info, as read by >>
 
 private:
    //------------------------------
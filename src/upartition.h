@@ -0,0 +1,89 @@
+#ifndef GUARD_upartition_h
+#define GUARD_upartition_h
+
+#include <Rcpp.h>
+
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#include "tree.h"
+#include "checkpoint.h"
+
+using namespace Rcpp;
+
+/*
+The partition of (0, 1) induced by the u cutpoints the mean trees use, for
+every kept draw. Stored CSR style: the sorted cut indices into the u grid of
+draw i are idx[offsets[i]], ..., idx[offsets[i + 1] - 1]. Draw i has
+offsets[i + 1] - offsets[i] + 1 intervals, the first starting at 0 and the
+last ending at 1.
+*/
+class UPartition {
+public:
+   UPartition() : offsets(1, 0) {}
+
+   //append a draw, cuts sorted
+   void add_draw(const std::vector<size_t>& cuts) {
+      for(size_t k=0;k<cuts.size();k++) {
+         if(cuts[k] > UINT16_MAX) stop("too many u cutpoints to store the u partition");
+         idx.push_back((uint16_t) cuts[k]);
+      }
+      offsets.push_back(idx.size());
+   }
+   size_t ndraws() const { return offsets.size() - 1; }
+   size_t nintervals(size_t i) const { return offsets[i + 1] - offsets[i] + 1; }
+
+   //widths and midpoints of the intervals of draw i, ugrid the u cutpoints
+   void widths(size_t i, const vec_d& ugrid, double* w) const {
+      double lo = 0.0;
+      for(size_t k=offsets[i];k<offsets[i + 1];k++) {
+         w[k - offsets[i]] = ugrid[idx[k]] - lo;
+         lo = ugrid[idx[k]];
+      }
+      w[offsets[i + 1] - offsets[i]] = 1.0 - lo;
+   }
+   void mids(size_t i, const vec_d& ugrid, double* mid) const {
+      double lo = 0.0;
+      for(size_t k=offsets[i];k<offsets[i + 1];k++) {
+         mid[k - offsets[i]] = 0.5*(lo + ugrid[idx[k]]);
+         lo = ugrid[idx[k]];
+      }
+      mid[offsets[i + 1] - offsets[i]] = 0.5*(lo + 1.0);
+   }
+
+   //keep the first n draws
+   void truncate(size_t n) {
+      offsets.resize(n + 1);
+      idx.resize(offsets[n]);
+   }
+
+   //to and from R: a raw vector of the uint16 indices and integer offsets
+   List to_list() const {
+      if(idx.size() > (size_t) INT_MAX) stop("u partition too large to return to R");
+      RawVector index(idx.size()*sizeof(uint16_t));
+      if(idx.size()) std::memcpy(&index[0], &idx[0], idx.size()*sizeof(uint16_t));
+      return List::create(_["index"] = index,
+                          _["offsets"] = IntegerVector(offsets.begin(), offsets.end()));
+   }
+   void from_list(List l) {
+      RawVector index = l["index"];
+      IntegerVector off = l["offsets"];
+      idx.resize(index.size()/sizeof(uint16_t));
+      if(idx.size()) std::memcpy(&idx[0], &index[0], idx.size()*sizeof(uint16_t));
+      offsets.assign(off.begin(), off.end());
+      if(offsets.empty() || offsets[0] != 0 || offsets.back() != idx.size())
+         stop("corrupt u partition");
+   }
+
+   void save(ckpt_out& out) const { out.put(idx); out.put(offsets); }
+   void load(ckpt_in& in) { in.get(idx); in.get(offsets); }
+
+private:
+   std::vector<uint16_t> idx;
+   std::vector<uint64_t> offsets;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef GUARD_ustore_h
+#define GUARD_ustore_h
+
+#include <Rcpp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tree.h"
+#include "checkpoint.h"
+
+using namespace Rcpp;
+
+/*
+What is kept of the posterior draws of the latent u. A dense nd x n matrix
+of doubles (the default, as before) gets too big for large n, so instead we
+can keep
+  none      nothing
+  moments   running mean and variance of u for each observation
+  quantized for each draw and observation the index of the interval of the
+            u cutpoints that u falls in, as a uint16. This loses nothing the
+            trees can see, since they only compare u to the cutpoints.
+  file      each draw streamed to a binary file of doubles, n per draw
+*/
+class u_store {
+public:
+   enum u_mode {DENSE, NONE, MOMENTS, QUANTIZED, FILE};
+
+   u_store() : mode(DENSE), nd(0), n(0), count(0) {}
+
+   //resume: a checkpoint is about to be loaded, so leave an existing u file alone
+   void init(const std::string& mode_name, size_t nd, size_t n,
+             const vec_d& ucuts, const std::string& path, bool resume=false)
+   {
+      this->nd = nd; this->n = n;
+      this->path = path;
+      count = 0;
+      if(mode_name == "dense") {
+         mode = DENSE;
+         dense = NumericMatrix(nd, n);
+      } else if(mode_name == "none") {
+         mode = NONE;
+      } else if(mode_name == "moments") {
+         mode = MOMENTS;
+         mean.assign(n, 0.0);
+         m2.assign(n, 0.0);
+      } else if(mode_name == "quantized") {
+         mode = QUANTIZED;
+         if(ucuts.size() >= 65535) stop("too many u cutpoints to quantize u to 16 bits");
+         cuts = ucuts;
+         q = RawVector(nd*n*sizeof(uint16_t));
+      } else if(mode_name == "file") {
+         mode = FILE;
+         if(!resume) {
+            fs.open(path.c_str(), std::ios::binary | std::ios::trunc);
+            if(!fs) stop("unable to open u file " + path);
+         }
+      } else {
+         stop("unknown u output mode " + mode_name);
+      }
+   }
+
+   //keep draw d of u, where u for observation k is x[k*p]
+   void record(size_t d, const double* x, size_t p)
+   {
+      switch(mode) {
+      case DENSE:
+         for(size_t k=0;k<n;k++) dense(d, k) = x[k*p];
+         break;
+      case NONE:
+         break;
+      case MOMENTS:
+         count++;
+         for(size_t k=0;k<n;k++) {
+            double delta = x[k*p] - mean[k];
+            mean[k] += delta/count;
+            m2[k] += delta*(x[k*p] - mean[k]);
+         }
+         break;
+      case QUANTIZED: {
+         uint16_t* qd = (uint16_t*) &q[0] + d*n;
+         for(size_t k=0;k<n;k++) {
+            //number of cutpoints <= u, i.e. the interval u is in
+            qd[k] = std::upper_bound(cuts.begin(), cuts.end(), x[k*p]) - cuts.begin();
+         }
+         break;
+      }
+      case FILE:
+         buf.resize(n);
+         for(size_t k=0;k<n;k++) buf[k] = x[k*p];
+         fs.write((const char*) &buf[0], n*sizeof(double));
+         break;
+      }
+   }
+
+   //add what we kept to the sampler's output
+   void add_output(List& out)
+   {
+      switch(mode) {
+      case DENSE:
+         out.push_back(dense, "uvals");
+         break;
+      case NONE:
+         break;
+      case MOMENTS: {
+         NumericVector u_var(n);
+         for(size_t k=0;k<n;k++) u_var[k] = count > 1 ? m2[k]/(count - 1) : NA_REAL;
+         out.push_back(NumericVector(mean.begin(), mean.end()), "u_mean");
+         out.push_back(u_var, "u_var");
+         break;
+      }
+      case QUANTIZED: {
+         //interval q is [u_edges[q], u_edges[q + 1]) (0-based)
+         NumericVector edges(cuts.size() + 2);
+         edges[0] = 0.0;
+         std::copy(cuts.begin(), cuts.end(), edges.begin() + 1);
+         edges[cuts.size() + 1] = 1.0;
+         out.push_back(q, "uvals_q");
+         out.push_back(edges, "u_edges");
+         out.push_back(IntegerVector::create(nd, n), "u_dim");
+         break;
+      }
+      case FILE:
+         fs.close();
+         out.push_back(path, "u_file");
+         out.push_back(IntegerVector::create(nd, n), "u_dim");
+         break;
+      }
+   }
+
+   //checkpoints. kept is the number of draws recorded so far
+   void save(ckpt_out& out, size_t kept)
+   {
+      switch(mode) {
+      case DENSE:
+         for(size_t k=0;k<n;k++) out.put(&dense[k*nd], kept); //column k, first kept rows
+         break;
+      case NONE:
+         break;
+      case MOMENTS:
+         out.put((uint64_t) count);
+         out.put(mean); out.put(m2);
+         break;
+      case QUANTIZED:
+         out.put(std::vector<uint8_t>(q.begin(), q.begin() + kept*n*sizeof(uint16_t)));
+         break;
+      case FILE:
+         fs.flush();
+         out.put((int64_t) fs.tellp());
+         break;
+      }
+   }
+   void load(ckpt_in& in, size_t kept)
+   {
+      switch(mode) {
+      case DENSE:
+         for(size_t k=0;k<n;k++) in.get(&dense[k*nd], kept);
+         break;
+      case NONE:
+         break;
+      case MOMENTS: {
+         uint64_t c; in.get(c);
+         count = c;
+         in.get(mean); in.get(m2);
+         break;
+      }
+      case QUANTIZED: {
+         std::vector<uint8_t> b; in.get(b);
+         std::copy(b.begin(), b.end(), q.begin());
+         break;
+      }
+      case FILE: {
+         int64_t len; in.get(len);
+         //drop whatever was written after the checkpoint
+         if(std::filesystem::file_size(path) < (uintmax_t) len) {
+            stop("u file is shorter than when the checkpoint was written");
+         }
+         std::filesystem::resize_file(path, len);
+         //ate, so tellp gives the file length even before the first write
+         fs.open(path.c_str(), std::ios::binary | std::ios::app | std::ios::ate);
+         if(!fs) stop("unable to open u file " + path);
+         break;
+      }
+      }
+   }
+
+   std::string name() const {
+      const char* names[] = {"dense", "none", "moments", "quantized", "file"};
+      return names[mode];
+   }
+   std::string file() const { return path; }
+
+private:
+   u_mode mode;
+   std::string path;
+   size_t nd, n;
+   NumericMatrix dense;
+   size_t count;
+   std::vector<double> mean, m2;
+   vec_d cuts;
+   RawVector q;
+   std::ofstream fs;
+   std::vector<double> buf;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "xfile.h"
+
+//--------------------------------------------------
+#ifndef _WIN32
+void mapped_x::open(const std::string& path)
+{
+   close();
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if(fd < 0) throw std::runtime_error("unable to open covariate file " + path);
+   struct stat st;
+   if(fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("unable to read covariate file " + path);
+   }
+   len = st.st_size;
+   if(len % sizeof(double)) {
+      ::close(fd);
+      throw std::runtime_error("covariate file " + path + " is not a whole number of doubles");
+   }
+   if(len) {
+      void* p = mmap(0, len, PROT_READ, MAP_SHARED, fd, 0);
+      if(p == MAP_FAILED) {
+         ::close(fd);
+         throw std::runtime_error("unable to map covariate file " + path);
+      }
+      base = p;
+      //passes go through the columns in order; read ahead and let pages go
+      madvise(base, len, MADV_SEQUENTIAL);
+   }
+   ::close(fd); //the mapping stays
+}
+
+void mapped_x::close()
+{
+   if(base) munmap(base, len);
+   base = 0;
+   len = 0;
+   buf.clear();
+}
+#else
+//no mmap: read the file in
+void mapped_x::open(const std::string& path)
+{
+   close();
+   std::ifstream is(path.c_str(), std::ios::binary | std::ios::ate);
+   if(!is) throw std::runtime_error("unable to open covariate file " + path);
+   len = is.tellg();
+   if(len % sizeof(double))
+      throw std::runtime_error("covariate file " + path + " is not a whole number of doubles");
+   buf.resize(len / sizeof(double));
+   is.seekg(0);
+   if(len && !is.read((char*) buf.data(), len))
+      throw std::runtime_error("unable to read covariate file " + path);
+}
+
+void mapped_x::close()
+{
+   len = 0;
+   buf.clear();
+   buf.shrink_to_fit();
+}
+#endif
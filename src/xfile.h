@@ -0,0 +1,39 @@
+#ifndef GUARD_xfile_h
+#define GUARD_xfile_h
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+Covariates in a file: n x p doubles, column-major, native byte order, no
+header. That is the backing file of a file-backed bigmemory double matrix,
+and what drbart writes for raw_matrix().
+
+The file is mapped read only, so the sampler can work on x larger than
+memory; the pages of a column are read as a pass over the observations gets
+to them, and with column-major storage every pass (fit, the sufficient
+statistics) walks each column it splits on front to back. Where there is no
+mmap the file is read in whole instead.
+*/
+
+class mapped_x {
+public:
+   mapped_x() : base(0), len(0) {}
+   ~mapped_x() { close(); }
+   mapped_x(const mapped_x&) = delete;
+   mapped_x& operator=(const mapped_x&) = delete;
+
+   void open(const std::string& path); //throws std::runtime_error
+   void close();
+
+   const double* data() const { return base ? (const double*) base : buf.data(); }
+   size_t size() const { return len / sizeof(double); }
+
+private:
+   void* base;               //the mapping, 0 if not mapped
+   size_t len;               //file size in bytes
+   std::vector<double> buf;  //the file's contents where it can't be mapped
+};
+
+#endif